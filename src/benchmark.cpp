@@ -0,0 +1,215 @@
+#include "benchmark.h"
+
+#include "directory_walker.h"
+#include "mapped_file.h"
+#include "marker_scanner.h"
+#include "name_matcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <algorithm>
+#include <random>
+
+namespace benchmark
+{
+	QString MarkerScan(QString const& path, int iterations)
+	{
+		QStringList const markers{ "(symbol (lib_id", R"((property "Footprint")", R"((property "Reference")", "(model ", "(fp_text reference" };
+		MarkerScanner const scanner{ "symbol", "property", "model", "fp_text" };
+
+		QElapsedTimer timer;
+		QStringList report;
+		report.append(QString("Marker scan of '%1', best of %2 runs").arg(path).arg(iterations));
+
+		qint64 best{ -1 };
+		int lineHits{ 0 };
+		for (int i = 0; i < iterations; ++i)
+		{
+			timer.start();
+			QFile inFile(path);
+			if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+			{
+				return QString("Could not Open '%1'").arg(path);
+			}
+			lineHits = 0;
+			QTextStream in(&inFile);
+			while (!in.atEnd())
+			{
+				QString const line = in.readLine();
+				for (auto const& marker : markers)
+				{
+					if (line.contains(marker))
+					{
+						++lineHits;
+						break;
+					}
+				}
+			}
+			inFile.close();
+			qint64 const elapsed{ timer.nsecsElapsed() };
+			best = best < 0 ? elapsed : std::min(best, elapsed);
+		}
+		report.append(QString("  QTextStream + QString::contains: %1 ms, %2 lines").arg(best / 1e6, 0, 'f', 2).arg(lineHits));
+
+		for (auto const kernel : { MarkerScanner::Kernel::Scalar, MarkerScanner::Kernel::SSE2, MarkerScanner::Kernel::AVX2 })
+		{
+			if (kernel > MarkerScanner::BestKernel())
+			{
+				continue;
+			}
+			best = -1;
+			std::size_t markerHits{ 0 };
+			for (int i = 0; i < iterations; ++i)
+			{
+				timer.start();
+				MappedFile const inFile(path);
+				markerHits = scanner.Scan(inFile.data(), kernel).size();
+				qint64 const elapsed{ timer.nsecsElapsed() };
+				best = best < 0 ? elapsed : std::min(best, elapsed);
+			}
+			report.append(QString("  MarkerScanner %1: %2 ms, %3 markers").arg(MarkerScanner::KernelName(kernel)).arg(best / 1e6, 0, 'f', 2).arg(markerHits));
+		}
+		return report.join("\n");
+	}
+
+	namespace
+	{
+		//the recursion FindRecurseFiles used before directory_walker
+		QStringList QDirRecurse(QString const& startDir, QStringList const& fileNames)
+		{
+			QStringList returnList;
+			QDir dir(startDir);
+			dir.setNameFilters(fileNames);
+			dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+			for (auto const& file : dir.entryInfoList())
+			{
+				returnList.append(file.filePath());
+			}
+
+			dir.setFilter(QDir::AllDirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+			for (auto const& sub : dir.entryList())
+			{
+				returnList.append(QDirRecurse(QString("%1/%2").arg(dir.absolutePath()).arg(sub), fileNames));
+			}
+			return returnList;
+		}
+	}
+
+	QString DirectoryWalk(int fileCount, int iterations)
+	{
+		QTemporaryDir root;
+		if (!root.isValid())
+		{
+			return QString("Could not create a temporary folder");
+		}
+
+		//100 files per folder, 10 folders per library, like a large .pretty share
+		constexpr int filesPerFolder{ 100 };
+		int const folders{ std::max(1, fileCount / filesPerFolder) };
+		for (int i = 0; i < folders; ++i)
+		{
+			QString const folder{ QString("%1/Lib_%2.pretty/sub_%3").arg(root.path()).arg(i / 10).arg(i % 10) };
+			QDir().mkpath(folder);
+			for (int f = 0; f < filesPerFolder; ++f)
+			{
+				QFile(QString("%1/FP_%2.kicad_mod").arg(folder).arg(f)).open(QIODevice::WriteOnly);
+			}
+		}
+		QFile(QString("%1/Lib_%2.pretty/target.kicad_mod").arg(root.path()).arg((folders - 1) / 10)).open(QIODevice::WriteOnly);
+
+		QStringList report;
+		report.append(QString("Directory walk of %1 files in %2 folders, best of %3 runs").arg(folders * filesPerFolder + 1).arg(folders).arg(iterations));
+
+		QElapsedTimer timer;
+		auto const time = [&](QString const& name, auto const& run)
+		{
+			qint64 best{ -1 };
+			qsizetype hits{ 0 };
+			for (int i = 0; i < iterations; ++i)
+			{
+				timer.start();
+				hits = run();
+				qint64 const elapsed{ timer.nsecsElapsed() };
+				best = best < 0 ? elapsed : std::min(best, elapsed);
+			}
+			report.append(QString("  %1: %2 ms, %3 found").arg(name).arg(best / 1e6, 0, 'f', 2).arg(hits));
+		};
+
+		QStringList const filter{ "*.kicad_mod" };
+		time("QDir recursion", [&]() { return QDirRecurse(root.path(), filter).size(); });
+		for (unsigned const threads : { 1u, 0u })
+		{
+			WalkOptions options;
+			options.nameFilters = filter;
+			options.threads = threads;
+			time(QString("directory_walker, %1 thread(s)").arg(threads == 0 ? QString("all") : QString::number(threads)),
+				[&]() { return directory_walker::Walk(root.path(), options).size(); });
+
+			options.nameFilters = QStringList{ "target.kicad_mod" };
+			options.stopAtFirst = true;
+			time(QString("directory_walker first match, %1 thread(s)").arg(threads == 0 ? QString("all") : QString::number(threads)),
+				[&]() { return directory_walker::Walk(root.path(), options).size(); });
+		}
+		return report.join("\n");
+	}
+
+	QString NameMatch(int nameCount, int queries)
+	{
+		//names built from the parts of the KiCad library, so the common trigrams ("_SM", "Met") have long posting lists
+		QStringList const libraries{ "Resistor_SMD", "Capacitor_SMD", "Inductor_SMD", "Package_SO", "Package_QFP", "Package_DFN_QFN", "Connector_PinHeader_2.54mm", "Diode_SMD" };
+		QStringList const prefixes{ "R", "C", "L", "SOIC", "TSSOP", "LQFP", "QFN", "PinHeader_1x", "D" };
+		QStringList const sizes{ "0402_1005Metric", "0603_1608Metric", "0805_2012Metric", "1206_3216Metric", "3.9x4.9mm_P1.27mm", "7x7mm_P0.5mm", "Vertical", "Horizontal" };
+
+		std::mt19937 random(42);
+		auto const pick = [&](QStringList const& list) { return list[static_cast<qsizetype>(random() % static_cast<unsigned>(list.size()))]; };
+
+		QStringList names;
+		names.reserve(nameCount);
+		for (int i = 0; i < nameCount; ++i)
+		{
+			names.append(QString("%1:%2-%3_%4").arg(pick(libraries)).arg(pick(prefixes)).arg(i).arg(pick(sizes)));
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		NameMatcher matcher;
+		for (auto const& name : names)
+		{
+			matcher.Add(name);
+		}
+		qint64 const build{ timer.nsecsElapsed() };
+
+		//one changed character, as in a renamed or mistyped footprint
+		QStringList misspelled;
+		misspelled.reserve(queries);
+		for (int i = 0; i < queries; ++i)
+		{
+			QString name{ names[static_cast<qsizetype>(random() % static_cast<unsigned>(names.size()))] };
+			name[static_cast<qsizetype>(random() % static_cast<unsigned>(name.size()))] = 'x';
+			misspelled.append(name);
+		}
+
+		qint64 slowest{ 0 };
+		qint64 total{ 0 };
+		qsizetype found{ 0 };
+		for (auto const& name : misspelled)
+		{
+			timer.start();
+			found += matcher.Find(name).isEmpty() ? 0 : 1;
+			qint64 const elapsed{ timer.nsecsElapsed() };
+			total += elapsed;
+			slowest = std::max(slowest, elapsed);
+		}
+
+		QStringList report;
+		report.append(QString("Name match against %1 names, %2 queries").arg(names.size()).arg(misspelled.size()));
+		report.append(QString("  index build: %1 ms").arg(build / 1e6, 0, 'f', 2));
+		report.append(QString("  NameMatcher::Find: %1 ms mean, %2 ms slowest, %3 with a match").arg(total / 1e6 / std::max(1, queries), 0, 'f', 3).arg(slowest / 1e6, 0, 'f', 3).arg(found));
+		return report.join("\n");
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+//Developer timings, run from the command line with --benchmark
+namespace benchmark
+{
+	//times the old QTextStream/QString::contains marker search against the mapped MarkerScanner kernels
+	QString MarkerScan(QString const& path, int iterations = 5);
+	//builds a synthetic tree of about fileCount .kicad_mod files and times the QDir recursion against directory_walker
+	QString DirectoryWalk(int fileCount = 100000, int iterations = 3);
+	//indexes nameCount synthetic "Library:Footprint" names and times NameMatcher::Find on misspelled ones
+	QString NameMatch(int nameCount = 100000, int queries = 1000);
+};
+
+#endif // BENCHMARK_H
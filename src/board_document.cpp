@@ -0,0 +1,93 @@
+#include "board_document.h"
+
+#include "mapped_file.h"
+#include "marker_scanner.h"
+#include "sexpr_tokenizer.h"
+
+#include <QFileInfo>
+
+std::shared_ptr<BoardDocument const> BoardDocument::Load(QString const& path)
+{
+	MappedFile const inFile(path);
+	if (!inFile.isOpen())
+	{
+		return nullptr;
+	}
+	return Parse(path, inFile.data());
+}
+
+std::shared_ptr<BoardDocument const> BoardDocument::Parse(QString const& path, std::string_view data)
+{
+	auto document{ std::make_shared<BoardDocument>() };
+	document->m_path = path;
+	document->m_fileName = QFileInfo(path).fileName();
+
+	static MarkerScanner const markers{ "footprint", "module" };
+	std::size_t footprintEnd{ 0 };
+	for (auto const offset : markers.Scan(data))
+	{
+		//"(footprint" inside a footprint is some other list, the outer one already read it
+		if (offset < footprintEnd)
+		{
+			continue;
+		}
+		SexprTokenizer tokens(data, offset);
+		tokens.Next();
+		tokens.Next();
+		auto const name{ tokens.Next() };
+		if (!name.isValue())
+		{
+			continue;
+		}
+
+		auto& footprint{ document->m_footprints.emplace_back() };
+		footprint.footprint = name.toQString();
+		footprint.offset = offset;
+
+		//only the direct children: (fp_text reference "R1"), (property "Reference" "R1"), (model "path"
+		for (auto token{ tokens.Next() }; !token.isEnd() && tokens.depth() > 0; token = tokens.Next())
+		{
+			if (!token.isOpen())
+			{
+				continue;
+			}
+			auto const key{ tokens.Next() };
+			if (key.isClose())
+			{
+				continue;
+			}
+			if (key.isAtom("fp_text") || key.isAtom("property"))
+			{
+				auto const kind{ tokens.Next() };
+				if (kind.isClose())
+				{
+					continue;
+				}
+				auto const value{ tokens.Next() };
+				if (value.isClose())
+				{
+					continue;
+				}
+				if ((kind.isAtom("reference") || kind.isString("Reference")) && value.isValue())
+				{
+					footprint.reference = value.toQString();
+				}
+			}
+			else if (key.isAtom("model"))
+			{
+				auto const model{ tokens.Next() };
+				if (model.isClose())
+				{
+					continue;
+				}
+				if (model.isValue() && !model.text.empty())
+				{
+					footprint.models.append(model.toQString());
+				}
+			}
+			tokens.SkipList();
+		}
+		footprintEnd = tokens.position();
+	}
+	return document;
+}
@@ -0,0 +1,37 @@
+#ifndef BOARD_DOCUMENT_H
+#define BOARD_DOCUMENT_H
+
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+//One placed footprint, "(footprint "Lib:Name"" or the older "(module Lib:Name" in a .kicad_pcb file
+struct BoardFootprint
+{
+	QString reference;
+	QString footprint;
+	QStringList models;
+	std::size_t offset{ 0 };
+};
+
+//Footprint inventory of a board, parsed in one pass and shared by the 3D model and schematic checks
+class BoardDocument
+{
+public:
+	static std::shared_ptr<BoardDocument const> Load(QString const& path);
+	static std::shared_ptr<BoardDocument const> Parse(QString const& path, std::string_view data);
+
+	QString const& path() const { return m_path; }
+	QString const& fileName() const { return m_fileName; }
+	std::vector<BoardFootprint> const& footprints() const { return m_footprints; }
+
+private:
+	QString m_path;
+	QString m_fileName;
+	std::vector<BoardFootprint> m_footprints;
+};
+
+#endif
@@ -0,0 +1,389 @@
+#include "directory_walker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	//workers of a walk that finds everything, a first match lookup walks on the calling thread
+	constexpr unsigned MAX_THREADS{ 8 };
+
+	//position in the depth-first walk, per level: 0/1 for file/folder then the sorted index
+	using WalkKey = std::vector<quint32>;
+
+	struct Task
+	{
+		fs::path dir;
+		QString name;
+		WalkKey key;
+		int depth{ 0 };
+	};
+
+	struct Entry
+	{
+		QString name;
+		fs::path path;
+		bool isDir{ false };
+	};
+
+	//QDir's default Name | IgnoreCase ordering
+	bool NameLess(Entry const& lhs, Entry const& rhs)
+	{
+		int const result{ QString::compare(lhs.name, rhs.name, Qt::CaseInsensitive) };
+		return result != 0 ? result < 0 : QString::compare(lhs.name, rhs.name, Qt::CaseSensitive) < 0;
+	}
+
+	QString ToQString(fs::path const& path)
+	{
+		return QString::fromStdU16String(path.generic_u16string());
+	}
+
+	//one deque per worker, the owner works depth first from the back and idle workers steal from the front
+	//a worker without work sleeps until a folder is queued or the walk is done
+	class WorkQueue
+	{
+	public:
+		explicit WorkQueue(std::size_t workers) : m_queues(workers) {}
+
+		void Push(std::size_t worker, Task task)
+		{
+			++m_pending;
+			{
+				std::lock_guard<std::mutex> const lock(m_queues[worker].lock);
+				m_queues[worker].tasks.push_back(std::move(task));
+			}
+			++m_queued;
+			Wake(false);
+		}
+
+		//false once every queued folder was visited
+		bool Wait(std::size_t worker, Task& task)
+		{
+			while (!Pop(worker, task))
+			{
+				std::unique_lock<std::mutex> lock(m_waitLock);
+				m_ready.wait(lock, [this]() { return m_queued > 0 || m_pending == 0; });
+				if (m_pending == 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void Done()
+		{
+			if (--m_pending == 0)
+			{
+				Wake(true);
+			}
+		}
+
+	private:
+		struct Queue
+		{
+			std::mutex lock;
+			std::deque<Task> tasks;
+		};
+
+		void Wake(bool all)
+		{
+			//taking the lock orders the change before a waiter's check, so no wake up is lost
+			{
+				std::lock_guard<std::mutex> const lock(m_waitLock);
+			}
+			if (all)
+			{
+				m_ready.notify_all();
+			}
+			else
+			{
+				m_ready.notify_one();
+			}
+		}
+
+		bool Pop(std::size_t worker, Task& task)
+		{
+			{
+				auto& own{ m_queues[worker] };
+				std::lock_guard<std::mutex> const lock(own.lock);
+				if (!own.tasks.empty())
+				{
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+					--m_queued;
+					return true;
+				}
+			}
+			for (std::size_t i = 1; i < m_queues.size(); ++i)
+			{
+				auto& other{ m_queues[(worker + i) % m_queues.size()] };
+				std::lock_guard<std::mutex> const lock(other.lock);
+				if (!other.tasks.empty())
+				{
+					task = std::move(other.tasks.front());
+					other.tasks.pop_front();
+					--m_queued;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::vector<Queue> m_queues;
+		std::atomic<std::size_t> m_pending{ 0 };	//queued or being visited
+		std::atomic<std::size_t> m_queued{ 0 };
+		std::mutex m_waitLock;
+		std::condition_variable m_ready;
+	};
+}
+
+namespace directory_walker
+{
+	bool WildcardMatch(QString const& pattern, QString const& name)
+	{
+		//iterative '*' backtracking, no allocation
+		qsizetype p{ 0 };
+		qsizetype n{ 0 };
+		qsizetype star{ -1 };
+		qsizetype mark{ 0 };
+		while (n < name.size())
+		{
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p].toLower() == name[n].toLower()))
+			{
+				++p;
+				++n;
+			}
+			else if (p < pattern.size() && pattern[p] == '*')
+			{
+				star = p++;
+				mark = n;
+			}
+			else if (star >= 0)
+			{
+				p = star + 1;
+				n = ++mark;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*')
+		{
+			++p;
+		}
+		return p == pattern.size();
+	}
+
+	QStringList Walk(QString const& root, WalkOptions const& options, QStringList* folders)
+	{
+		std::error_code error;
+		fs::path const start{ root.toStdU16String() };
+		if (!fs::is_directory(start, error))
+		{
+			return QStringList();
+		}
+
+		//a first match is usually near the front of the walk, extra workers would mostly walk folders that get pruned
+		unsigned const threads{ options.threads != 0 ? options.threads :
+			options.stopAtFirst ? 1u : std::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREADS) };
+		WorkQueue queue(threads);
+
+		//first match mode: anything that comes after the best match so far in walk order is skipped
+		std::mutex bestLock;
+		WalkKey best;
+		bool haveBest{ false };
+		auto const beaten = [&](WalkKey const& key)
+		{
+			std::lock_guard<std::mutex> const lock(bestLock);
+			return haveBest && best < key;
+		};
+		auto const record = [&](WalkKey const& key)
+		{
+			std::lock_guard<std::mutex> const lock(bestLock);
+			if (!haveBest || key < best)
+			{
+				best = key;
+				haveBest = true;
+			}
+		};
+
+		//canonical folders already walked, only needed when symlinks are followed
+		std::mutex visitedLock;
+		std::set<fs::path> visited;
+		if (options.followSymlinks)
+		{
+			visited.insert(fs::canonical(start, error));
+		}
+
+		std::vector<std::vector<std::pair<WalkKey, QString>>> found(threads);
+		std::vector<std::vector<std::pair<WalkKey, QString>>> listed(folders != nullptr ? threads : 0);
+
+		auto const matchFile = [&](QString const& name)
+		{
+			if (options.nameFilters.isEmpty())
+			{
+				return true;
+			}
+			return std::any_of(options.nameFilters.begin(), options.nameFilters.end(), [&](QString const& filter) { return WildcardMatch(filter, name); });
+		};
+
+		auto const visit = [&](std::size_t worker, Task const& task)
+		{
+			if (options.stopAtFirst && beaten(task.key))
+			{
+				return;
+			}
+			if (task.depth > 0 && options.matchDir && options.matchDir(task.name))
+			{
+				found[worker].emplace_back(task.key, ToQString(task.dir));
+				if (options.stopAtFirst)
+				{
+					record(task.key);
+				}
+				return;
+			}
+			if (task.depth >= options.maxDepth)
+			{
+				return;
+			}
+
+			std::error_code listError;
+			std::error_code entryError;
+			std::vector<Entry> entries;
+			for (fs::directory_iterator it(task.dir, fs::directory_options::skip_permission_denied, listError), end; !listError && it != end; it.increment(listError))
+			{
+				QString name{ QString::fromStdU16String(it->path().filename().u16string()) };
+				if (name.startsWith('.'))
+				{
+					continue;
+				}
+
+				bool const link{ it->is_symlink(entryError) };
+				if (link && !options.followSymlinks)
+				{
+					continue;
+				}
+				bool const isDir{ it->is_directory(entryError) };
+				if (link && isDir)
+				{
+					//a link back into a folder we already walk would loop forever
+					auto const target{ fs::canonical(it->path(), entryError) };
+					std::lock_guard<std::mutex> const lock(visitedLock);
+					if (entryError || !visited.insert(target).second)
+					{
+						continue;
+					}
+				}
+				entries.push_back({ std::move(name), it->path(), isDir });
+			}
+			std::sort(entries.begin(), entries.end(), NameLess);
+			if (folders != nullptr)
+			{
+				listed[worker].emplace_back(task.key, ToQString(task.dir));
+			}
+
+			quint32 fileIndex{ 0 };
+			std::vector<Task> subDirs;
+			for (auto& entry : entries)
+			{
+				if (!entry.isDir)
+				{
+					if (options.files && matchFile(entry.name))
+					{
+						WalkKey key{ task.key };
+						key.push_back(0);
+						key.push_back(fileIndex);
+						if (options.stopAtFirst)
+						{
+							//the rest of this folder and its sub folders all come later
+							record(key);
+							found[worker].emplace_back(std::move(key), ToQString(entry.path));
+							return;
+						}
+						found[worker].emplace_back(std::move(key), ToQString(entry.path));
+					}
+					++fileIndex;
+					continue;
+				}
+				WalkKey key{ task.key };
+				key.push_back(1);
+				key.push_back(static_cast<quint32>(subDirs.size()));
+				if (options.followSymlinks)
+				{
+					std::lock_guard<std::mutex> const lock(visitedLock);
+					visited.insert(fs::canonical(entry.path, entryError));
+				}
+				subDirs.push_back({ std::move(entry.path), std::move(entry.name), std::move(key), task.depth + 1 });
+			}
+
+			//reversed so the owner pops the first sub folder next, which keeps a single worker depth first
+			for (auto it{ subDirs.rbegin() }; it != subDirs.rend(); ++it)
+			{
+				queue.Push(worker, std::move(*it));
+			}
+		};
+
+		auto const work = [&](std::size_t worker)
+		{
+			Task task;
+			while (queue.Wait(worker, task))
+			{
+				visit(worker, task);
+				queue.Done();
+			}
+		};
+
+		queue.Push(0, { start, QString(), WalkKey(), 0 });
+		std::vector<std::thread> workers;
+		for (unsigned i = 1; i < threads; ++i)
+		{
+			workers.emplace_back(work, i);
+		}
+		work(0);
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		auto const merge = [](std::vector<std::vector<std::pair<WalkKey, QString>>>& lists, std::size_t limit)
+		{
+			std::vector<std::pair<WalkKey, QString>> results;
+			for (auto& list : lists)
+			{
+				std::move(list.begin(), list.end(), std::back_inserter(results));
+			}
+			std::sort(results.begin(), results.end(), [](auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+			if (results.size() > limit)
+			{
+				results.resize(limit);
+			}
+
+			QStringList paths;
+			paths.reserve(static_cast<qsizetype>(results.size()));
+			for (auto& [key, path] : results)
+			{
+				paths.append(std::move(path));
+			}
+			return paths;
+		};
+
+		if (folders != nullptr)
+		{
+			*folders = merge(listed, std::numeric_limits<std::size_t>::max());
+		}
+		return merge(found, options.stopAtFirst ? 1 : std::numeric_limits<std::size_t>::max());
+	}
+}
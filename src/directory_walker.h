@@ -0,0 +1,36 @@
+#ifndef DIRECTORY_WALKER_H
+#define DIRECTORY_WALKER_H
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+//How a walk visits a tree, the defaults match the old QDir recursion (no hidden entries, no symlinks)
+struct WalkOptions
+{
+	//file name filters like "*.kicad_mod", case insensitive, empty matches every file
+	QStringList nameFilters;
+	//folders are offered to matchDir when they are visited, a matching folder is not descended into
+	std::function<bool(QString const& name)> matchDir;
+	bool files{ true };
+	bool followSymlinks{ false };
+	//only the first match in walk order is returned, later parts of the tree are pruned as soon as one is found
+	bool stopAtFirst{ false };
+	int maxDepth{ 64 };
+	//0 = one per core up to 8, or the calling thread alone for stopAtFirst; 1 walks on the calling thread
+	unsigned threads{ 0 };
+};
+
+//Directory walker on top of std::filesystem (readdir d_type / FindFirstFile data, no stat per entry)
+//sub folders are handed out to a pool of workers, results are returned in QDir depth-first name order
+namespace directory_walker
+{
+	//folders gets root and every folder that was listed, in walk order
+	QStringList Walk(QString const& root, WalkOptions const& options, QStringList* folders = nullptr);
+
+	//case insensitive '*' and '?' match, as QDir name filters do
+	bool WildcardMatch(QString const& pattern, QString const& name);
+}
+
+#endif
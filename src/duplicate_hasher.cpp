@@ -0,0 +1,184 @@
+#include "duplicate_hasher.h"
+
+#include "legacy_indexer.h"
+#include "mapped_file.h"
+#include "sexpr_tokenizer.h"
+#include "symbol_indexer.h"
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+	//stands in for the item's own name so renamed copies hash the same
+	constexpr char NAME_MARK{ '\x01' };
+
+	//lists that change on every save without changing the item
+	bool IsVolatile(std::string_view key)
+	{
+		static constexpr std::array<std::string_view, 6> keys{ "tstamp", "uuid", "tedit", "timestamp", "generator", "generator_version" };
+		return std::find(keys.begin(), keys.end(), key) != keys.end();
+	}
+
+	void AppendField(QByteArray& out, std::string_view field, std::string_view name)
+	{
+		if (field == name)
+		{
+			out.append(NAME_MARK);
+			return;
+		}
+		//unit sub-symbols are called "name_unit_style"
+		if (!name.empty() && field.size() > name.size() && field.substr(0, name.size()) == name && field[name.size()] == '_')
+		{
+			out.append(NAME_MARK);
+			field.remove_prefix(name.size());
+		}
+		out.append(field.data(), static_cast<qsizetype>(field.size()));
+	}
+
+	QByteArray Hash(QByteArray const& normalized)
+	{
+		return QCryptographicHash::hash(normalized, QCryptographicHash::Sha1);
+	}
+}
+
+namespace duplicate_hasher
+{
+	QByteArray NormalizeSexpr(std::string_view body, QByteArray const& name)
+	{
+		std::string_view const nameView(name.constData(), static_cast<std::size_t>(name.size()));
+		QByteArray out;
+		out.reserve(static_cast<qsizetype>(body.size()));
+
+		SexprTokenizer tokens(body);
+		for (auto token{ tokens.Next() }; !token.isEnd(); token = tokens.Next())
+		{
+			if (token.isOpen())
+			{
+				auto const key{ tokens.Peek() };
+				if (key.type == SexprToken::Type::Atom && IsVolatile(key.text))
+				{
+					tokens.Next();
+					tokens.SkipList();
+					continue;
+				}
+				out.append('(');
+			}
+			else if (token.isClose())
+			{
+				out.append(')');
+			}
+			else
+			{
+				out.append(token.type == SexprToken::Type::String ? '"' : ' ');
+				AppendField(out, token.text, nameView);
+			}
+		}
+		return out;
+	}
+
+	QByteArray NormalizeLegacy(std::string_view body, QByteArray const& name)
+	{
+		std::string_view const nameView(name.constData(), static_cast<std::size_t>(name.size()));
+		QByteArray out;
+		out.reserve(static_cast<qsizetype>(body.size()));
+
+		std::size_t pos{ 0 };
+		while (pos < body.size())
+		{
+			std::size_t end{ body.find('\n', pos) };
+			if (end == std::string_view::npos)
+			{
+				end = body.size();
+			}
+			std::string_view line{ body.substr(pos, end - pos) };
+			pos = end + 1;
+
+			std::vector<std::string_view> fields;
+			std::size_t start{ 0 };
+			while (start < line.size())
+			{
+				start = line.find_first_not_of(" \t\r", start);
+				if (start == std::string_view::npos)
+				{
+					break;
+				}
+				std::size_t const stop{ std::min(line.find_first_of(" \t\r", start), line.size()) };
+				fields.push_back(line.substr(start, stop - start));
+				start = stop;
+			}
+			if (fields.empty())
+			{
+				continue;
+			}
+
+			auto const& key{ fields.front() };
+			if (key == "Sc" || key == "AR" || key == "Li" || key == "$MODULE" || key == "$EndMODULE")
+			{
+				continue;
+			}
+			for (std::size_t i = 0; i < fields.size(); ++i)
+			{
+				//"Po x y orient layer tedit tstamp attrs"
+				if (key == "Po" && (i == 5 || i == 6))
+				{
+					continue;
+				}
+				auto field{ fields[i] };
+				if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+				{
+					field = field.substr(1, field.size() - 2);
+				}
+				out.append(' ');
+				AppendField(out, field, nameView);
+			}
+			out.append('\n');
+		}
+		return out;
+	}
+
+	std::vector<HashedItem> HashFile(QString const& path, LibraryItemFormat format)
+	{
+		std::vector<HashedItem> items;
+
+		MappedFile const inFile(path);
+		if (!inFile.isOpen())
+		{
+			return items;
+		}
+		auto const data{ inFile.data() };
+
+		switch (format)
+		{
+		case LibraryItemFormat::KicadFootprint:
+		{
+			QString name{ QFileInfo(path).completeBaseName() };
+			QByteArray hash{ Hash(NormalizeSexpr(data, name.toUtf8())) };
+			items.push_back({ std::move(name), std::move(hash) });
+			break;
+		}
+		case LibraryItemFormat::KicadSymbols:
+			for (auto& entry : symbol_indexer::Index(data))
+			{
+				QByteArray hash{ Hash(NormalizeSexpr(data.substr(entry.offset, entry.length), entry.name.toUtf8())) };
+				items.push_back({ std::move(entry.name), std::move(hash) });
+			}
+			break;
+		case LibraryItemFormat::LegacyFootprints:
+		case LibraryItemFormat::LegacySymbols:
+		{
+			auto entries{ format == LibraryItemFormat::LegacyFootprints ? legacy_indexer::IndexFootprints(data) : legacy_indexer::IndexSymbols(data) };
+			for (auto& entry : entries)
+			{
+				QByteArray hash{ Hash(NormalizeLegacy(data.substr(entry.offset, entry.length), entry.name.toUtf8())) };
+				items.push_back({ std::move(entry.name), std::move(hash) });
+			}
+			break;
+		}
+		}
+		return items;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef DUPLICATE_HASHER_H
+#define DUPLICATE_HASHER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <string_view>
+#include <vector>
+
+//How the items of a library file are laid out
+enum class LibraryItemFormat
+{
+	KicadFootprint,		//one .kicad_mod file
+	KicadSymbols,		//every "(symbol" of a .kicad_sym file
+	LegacyFootprints,	//every $MODULE block of a .mod file
+	LegacySymbols		//every DEF block of a .lib file
+};
+
+//One footprint or symbol with the hash of its normalized body
+struct HashedItem
+{
+	QString name;
+	QByteArray hash;
+};
+
+//Content hashes that are equal for items that only differ by name, uuids or timestamps
+namespace duplicate_hasher
+{
+	std::vector<HashedItem> HashFile(QString const& path, LibraryItemFormat format);
+
+	//tokens without layout, (tstamp/uuid/tedit ...) lists dropped, name and "name_1_1" unit names replaced
+	QByteArray NormalizeSexpr(std::string_view body, QByteArray const& name);
+	//fields without layout, Sc/AR/Li lines and the Po timestamps dropped, name fields replaced
+	QByteArray NormalizeLegacy(std::string_view body, QByteArray const& name);
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "file_patch.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+	//largest single write, keeps the OS write buffers busy without one huge copy
+	constexpr std::size_t STREAM_CHUNK{ 1 << 20 };
+
+	bool WriteChunked(QIODevice& out, std::string_view data)
+	{
+		for (std::size_t pos = 0; pos < data.size(); pos += STREAM_CHUNK)
+		{
+			auto const chunk{ data.substr(pos, STREAM_CHUNK) };
+			if (out.write(chunk.data(), static_cast<qint64>(chunk.size())) != static_cast<qint64>(chunk.size()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace file_patch
+{
+	QByteArray Apply(std::string_view data, std::vector<FilePatch> patches)
+	{
+		std::stable_sort(patches.begin(), patches.end(), [](auto const& a, auto const& b) { return a.offset < b.offset; });
+
+		qsizetype size{ static_cast<qsizetype>(data.size()) };
+		for (auto const& patch : patches)
+		{
+			size += patch.replacement.size() - static_cast<qsizetype>(patch.length);
+		}
+
+		QByteArray output;
+		output.reserve(size);
+		std::size_t pos{ 0 };
+		for (auto const& patch : patches)
+		{
+			std::size_t const offset{ std::clamp(patch.offset, pos, data.size()) };
+			output.append(data.data() + pos, static_cast<qsizetype>(offset - pos));
+			output.append(patch.replacement);
+			pos = std::min(offset + patch.length, data.size());
+		}
+		output.append(data.data() + pos, static_cast<qsizetype>(data.size() - pos));
+		return output;
+	}
+
+	bool WriteWithBackup(QString const& path, QByteArray const& contents, QString& error)
+	{
+		QString const backup{ path + "_old" };
+		if (QFile::exists(backup))
+		{
+			QFile::remove(backup);
+		}
+		if (!QFile::rename(path, backup))
+		{
+			error = QString("Could not Create '%1'").arg(backup);
+			return false;
+		}
+
+		QFile outFile(path);
+		if (!outFile.open(QIODevice::WriteOnly))
+		{
+			error = QString("Could not Open '%1'").arg(path);
+			return false;
+		}
+		if (outFile.write(contents) != contents.size())
+		{
+			error = QString("Could not Write '%1'").arg(path);
+			return false;
+		}
+		outFile.close();
+		return true;
+	}
+
+	bool Stream(QIODevice& out, std::string_view data, std::vector<FilePatch> patches)
+	{
+		std::stable_sort(patches.begin(), patches.end(), [](auto const& a, auto const& b) { return a.offset < b.offset; });
+
+		std::size_t pos{ 0 };
+		for (auto const& patch : patches)
+		{
+			std::size_t const offset{ std::clamp(patch.offset, pos, data.size()) };
+			if (!WriteChunked(out, data.substr(pos, offset - pos)) || out.write(patch.replacement) != patch.replacement.size())
+			{
+				return false;
+			}
+			pos = std::min(offset + patch.length, data.size());
+		}
+		return WriteChunked(out, data.substr(pos));
+	}
+
+	bool CommitWithBackup(QSaveFile& file, QString const& path, QString& error)
+	{
+		QString const backup{ path + "_old" };
+		if (QFile::exists(backup))
+		{
+			QFile::remove(backup);
+		}
+
+		//a hard link keeps path in place until the commit replaces it in one rename
+		std::error_code linkError;
+		std::filesystem::create_hard_link(path.toStdU16String(), backup.toStdU16String(), linkError);
+		if (linkError && !QFile::copy(path, backup))
+		{
+			file.cancelWriting();
+			error = QString("Could not Create '%1'").arg(backup);
+			return false;
+		}
+
+		if (!file.commit())
+		{
+			error = QString("Could not Write '%1'").arg(path);
+			return false;
+		}
+		return true;
+	}
+
+	QByteArray LineEnding(std::string_view data)
+	{
+		auto const newline{ data.find('\n') };
+		return newline != std::string_view::npos && newline > 0 && data[newline - 1] == '\r' ? QByteArray("\r\n") : QByteArray("\n");
+	}
+}
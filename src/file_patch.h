@@ -0,0 +1,39 @@
+#ifndef FILE_PATCH_H
+#define FILE_PATCH_H
+
+#include <QString>
+#include <QByteArray>
+
+class QIODevice;
+class QSaveFile;
+
+#include <string_view>
+#include <vector>
+
+//Replaces length bytes at offset of the original buffer, a length of zero is an insertion
+struct FilePatch
+{
+	std::size_t offset{ 0 };
+	std::size_t length{ 0 };
+	QByteArray replacement;
+};
+
+namespace file_patch
+{
+	//copy of data with all the patches spliced in, patches must not overlap
+	QByteArray Apply(std::string_view data, std::vector<FilePatch> patches);
+
+	//moves path to "path_old" and writes contents in its place
+	bool WriteWithBackup(QString const& path, QByteArray const& contents, QString& error);
+
+	//writes data with the patches spliced in straight to out, in chunks, without building the whole file in memory
+	bool Stream(QIODevice& out, std::string_view data, std::vector<FilePatch> patches);
+
+	//keeps the current path as "path_old" and atomically moves the finished file in its place
+	bool CommitWithBackup(QSaveFile& file, QString const& path, QString& error);
+
+	//"\r\n" if the buffer already uses it, so inserted lines match the rest of the file
+	QByteArray LineEnding(std::string_view data);
+}
+
+#endif
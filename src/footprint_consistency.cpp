@@ -0,0 +1,130 @@
+#include "footprint_consistency.h"
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+namespace
+{
+	bool IsAnnotated(QString const& reference)
+	{
+		return !reference.isEmpty() && !reference.startsWith('#') && !reference.contains('*') && !reference.endsWith('?');
+	}
+
+	//the references of every instance of component, see Compare
+	QStringList References(SchematicComponent const& component, QString const& project, QHash<QString, QStringList> const& rootInstances)
+	{
+		QStringList references;
+		for (auto const& instance : component.instances)
+		{
+			if ((project.isEmpty() || instance.project == project) && !references.contains(instance.reference))
+			{
+				references.append(instance.reference);
+			}
+		}
+		if (references.isEmpty() && !component.uuid.isEmpty())
+		{
+			references = rootInstances.value(component.uuid);
+		}
+		if (references.isEmpty())
+		{
+			references.append(component.reference);
+		}
+		return references;
+	}
+}
+
+QString FootprintMismatch::asString() const
+{
+	switch (kind)
+	{
+	case Kind::Differs:
+		return QString("'%1' is '%2' in '%3' but '%4' on the board").arg(reference).arg(schematicFootprint).arg(sheet).arg(boardFootprint);
+	case Kind::Missing:
+		return QString("'%1':'%2' from '%3' is missing on the board").arg(reference).arg(schematicFootprint).arg(sheet);
+	case Kind::Extra:
+	default:
+		return QString("'%1':'%2' is on the board but not in the schematic").arg(reference).arg(boardFootprint);
+	}
+}
+
+namespace footprint_consistency
+{
+	std::vector<FootprintMismatch> Compare(std::vector<std::shared_ptr<SchematicDocument const>> const& sheets, BoardDocument const& board, QString const& project)
+	{
+		std::vector<FootprintMismatch> mismatches;
+
+		//KiCad 6 "/sheet uuid/symbol uuid" -> references
+		QHash<QString, QStringList> rootInstances;
+		for (auto const& sheet : sheets)
+		{
+			if (!sheet)
+			{
+				continue;
+			}
+			for (auto const& instance : sheet->symbolInstances())
+			{
+				auto& references{ rootInstances[instance.path.section('/', -1)] };
+				if (!references.contains(instance.reference))
+				{
+					references.append(instance.reference);
+				}
+			}
+		}
+
+		QHash<QString, BoardFootprint const*> onBoard;
+		onBoard.reserve(static_cast<qsizetype>(board.footprints().size()));
+		for (auto const& footprint : board.footprints())
+		{
+			if (IsAnnotated(footprint.reference))
+			{
+				onBoard.insert(footprint.reference, &footprint);
+			}
+		}
+
+		//units of one part share a reference and are only compared once
+		QSet<QString> seen;
+		for (auto const& sheet : sheets)
+		{
+			if (!sheet)
+			{
+				continue;
+			}
+			for (auto const& component : sheet->components())
+			{
+				for (auto const& reference : References(component, project, rootInstances))
+				{
+					if (!IsAnnotated(reference) || seen.contains(reference))
+					{
+						continue;
+					}
+					seen.insert(reference);
+
+					auto const found{ onBoard.constFind(reference) };
+					if (found == onBoard.constEnd())
+					{
+						//symbols without a footprint or excluded from the board are never placed
+						if (!component.footprint.isEmpty() && component.onBoard)
+						{
+							mismatches.push_back({ FootprintMismatch::Kind::Missing, reference, component.footprint, QString(), sheet->fileName() });
+						}
+						continue;
+					}
+					if (found.value()->footprint != component.footprint)
+					{
+						mismatches.push_back({ FootprintMismatch::Kind::Differs, reference, component.footprint, found.value()->footprint, sheet->fileName() });
+					}
+				}
+			}
+		}
+
+		for (auto const& footprint : board.footprints())
+		{
+			if (IsAnnotated(footprint.reference) && !seen.contains(footprint.reference))
+			{
+				mismatches.push_back({ FootprintMismatch::Kind::Extra, footprint.reference, QString(), footprint.footprint, QString() });
+			}
+		}
+		return mismatches;
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef FOOTPRINT_CONSISTENCY_H
+#define FOOTPRINT_CONSISTENCY_H
+
+#include "board_document.h"
+#include "schematic_document.h"
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+//A reference whose footprint isn't the same in the schematic and on the board
+struct FootprintMismatch
+{
+	enum class Kind { Differs, Missing, Extra };
+
+	Kind kind{ Kind::Differs };
+	QString reference;
+	QString schematicFootprint;
+	QString boardFootprint;
+	QString sheet;		//schematic file name, empty for footprints only on the board
+
+	QString asString() const;
+};
+
+namespace footprint_consistency
+{
+	//hash join on the reference, one pass over each side
+	//a sheet used more than once is compared once per instance, with the references of project (KiCad 7+ instances)
+	//or of the KiCad 6 root symbol_instances, and with the reference property when neither lists the symbol
+	//power symbols (#PWR) and board only footprints without a real reference (REF**, logos) are left out,
+	//symbols excluded from the board are never reported missing
+	std::vector<FootprintMismatch> Compare(std::vector<std::shared_ptr<SchematicDocument const>> const& sheets, BoardDocument const& board, QString const& project = QString());
+}
+
+#endif
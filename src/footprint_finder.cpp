@@ -1,12 +1,14 @@
 #include "footprint_finder.h"
 
 #include "kicad_utils.h"
+#include "schematic_document.h"
 
 #include <QFile>
 #include <QDir>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QSet>
 
 FootprintFinder::FootprintFinder()
 {
@@ -64,118 +66,87 @@ bool FootprintFinder::CheckSchematics()
 
 
     auto const& kicadFiles {directory.entryInfoList(QStringList() << "*.kicad_sch" , QDir::Files)};
-	for (auto const& file : kicadFiles)
-	{
-		emit SendMessage(QString("Checking '%1'").arg(file.fileName()), spdlog::level::level_enum::debug, file.absoluteFilePath());
-		CheckSchematic(file.absoluteFilePath());
-	}
+    for (auto const& report : CheckSheets(kicadFiles, [this](SheetReport& report) { CheckSchematic(report); }))
+    {
+        for (auto const& footprint : report.missing)
+        {
+            if (!missingFootprintList.contains(footprint))
+            {
+                missingFootprintList.append(footprint);
+            }
+        }
+    }
 	return true;
 }
 
-void FootprintFinder::CheckSchematic(QString const& schPath)
+void FootprintFinder::CheckSchematic(SheetReport& report) const
 {
-    QFileInfo fileData(schPath);
-    QFile inFile(schPath);
+    auto const& document{ report.document };
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-	{
-		emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-		return;
-	}
     bool errorFound{false};
-    bool partSection{false};
-    //int lineCount{0};
-
-    QString reference;
-	QTextStream in(&inFile);
-	while (!in.atEnd())
-	{
-        //lineCount++;
-		QString line = in.readLine();
-
-        if(line.contains("(symbol (lib_id"))
-		{
-			partSection = true;
-		}
-        if(!partSection)
-		{
-			continue;
-		}
-
-        QString ref = getSchReference( line);
-        if(!ref.isEmpty())
-        {
-            reference = ref;
-        }
-
-        QString footprint = getSchFootprint( line );
-        if(footprint.isEmpty())
+    for (auto const& component : document->components())
+    {
+        if(component.footprint.isEmpty())
         {
             continue;
         }
-        if(!HasFootprint(footprint))
+        if(!HasFootprint(component.footprint))
         {
-            if (!missingFootprintList.contains(footprint))
+            report.missing.append(component.footprint);
+            report.results.emplace_back(QString("'%1':'%2' was not found in '%3'").arg(component.reference).arg(component.footprint).arg(document->fileName()),true);
+            for (auto const& match : footprintMatcher.Find(component.footprint))
             {
-                missingFootprintList.append(footprint);
+                report.results.emplace_back(QString("'%1' might be '%2'").arg(component.footprint).arg(match), false);
             }
-            emit SendResult(QString("'%1':'%2' was not found in '%3'").arg(reference).arg(footprint).arg(fileData.fileName()),true);
             errorFound = true;
         }
-        reference.clear();
-	}
-	inFile.close();
+    }
 
     if(!errorFound)
     {
-        emit SendResult(QString("'%1' is Good").arg(fileData.fileName()), false);
+        report.results.emplace_back(QString("'%1' is Good").arg(document->fileName()), false);
     }
 }
 
 bool FootprintFinder::HasFootprint(QString const& footprint) const
 {
-    if(!footprint.contains(":"))
-    {
-        return false;
-    }
-    auto parts {footprint.split(":")};
-
-    if(!footprintList.contains(parts[0]))
-    {
-        return false;
-    }
-
-    auto const& list = footprintList.value(parts[0]);
-
-    return list.contains(parts[1]);
+    return footprintIndex.Contains(footprint);
 }
 
 void FootprintFinder::CreateFootprintList()
 {
-    footprintList.clear();
+    footprintIndex.Clear();
+    footprintMatcher.Clear();
+
+    auto names{ LoadLibraryNames([this](LibraryInfo const& lib) { return GetFootprints(lib.url, lib.type); }) };
+    std::size_t index{ 0 };
+    QSet<QString> nicknames;
 
     for(auto const& [level,library] : libraryList)
     {
         for(auto const& lib : library)
         {
-            if(footprintList.contains(lib.name))
+            QStringList fps{ std::move(names[index++]) };
+            if(footprintIndex.HasLibrary(lib.name))
             {
                 SendMessage(QString("Duplicate Libraries %1").arg(lib.name), spdlog::level::level_enum::warn, QString());
                 continue;
             }
-            QStringList fps;
-            if(lib.type == LEGACY_LIB)
-            {
-                fps = GetLegacyFootprints(lib.url);
-            }
-            else if(lib.type == KICAD_LIB)
+            //missing libraries and later entries of a nickname were skipped by the workers, this reports them as before
+            bool const duplicate{ nicknames.contains(lib.name) };
+            nicknames.insert(lib.name);
+            if(fps.empty() && (duplicate || !QFileInfo::exists(updatePath(lib.url))))
             {
-                fps = GetKicadFootprints(lib.url);
+                fps = GetFootprints(lib.url, lib.type);
             }
 
             if(!fps.empty())
             {
-                footprintList.insert(lib.name, fps);
+                footprintIndex.AddLibrary(lib.name, fps);
+                for (auto const& name : fps)
+                {
+                    footprintMatcher.Add(lib.name + ":" + name);
+                }
             }
             else
             {
@@ -183,6 +154,8 @@ void FootprintFinder::CreateFootprintList()
             }
         }
     }
+
+    emit SendMessage(QString("Indexed %1 footprints in %2 libraries (%3 KB)").arg(footprintIndex.itemCount()).arg(footprintIndex.libraryCount()).arg(footprintIndex.memoryUsage() / 1024), spdlog::level::level_enum::debug, QString());
 }
 
 QStringList FootprintFinder::GetLegacyFootprints(QString const& url) const
@@ -191,51 +164,22 @@ QStringList FootprintFinder::GetLegacyFootprints(QString const& url) const
 
     auto fullPath = updatePath(url);
 
-    //QFileInfo fileData(fullPath);
-    QFile inFile(fullPath);
-
-    if(!inFile.exists())
+    if(!QFile::exists(fullPath))
     {
         emit SendResult(QString("'%1' doesnt' exist").arg(fullPath), true);
         return list;
     }
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-	{
-		return list;
-	}
-
-	QTextStream in(&inFile);
-	while (!in.atEnd())
-	{
-		QString line = in.readLine();
-
-        if(!line.startsWith("Li"))
-		{
-			continue;
-		}
-
-        auto parts = line.split(" ", Qt::SkipEmptyParts);
-
-        if(parts.count() < 2)
-        {
-            continue;
-        }
-
-        auto name{parts[1]};
-
-        name = kicad_utils::CleanQuotes(name);
-
-        if(name.isEmpty())
-        {
-            continue;
-        }
-
-        list.append(name);
-	}
-	inFile.close();
-
+    auto const library{ m_legacyIndex->Footprints(fullPath) };
+    if (!library)
+    {
+        return list;
+    }
 
+    for (auto const& entry : library->entries())
+    {
+        list.append(entry.name);
+    }
     return list;
 }
 
@@ -252,6 +196,21 @@ QStringList FootprintFinder::GetKicadFootprints(QString const& url) const
         return list;
     }
 
+    //.pretty folders inside the watched library folder are listed from memory, an unwatched index may be stale
+    QStringList indexed;
+    if(m_liveFolderIndex && m_liveFolderIndex->watched() && m_liveFolderIndex->ListFiles(fullPath, indexed))
+    {
+        for (auto const& file : indexed)
+        {
+            QFileInfo const info(file);
+            if (info.suffix().compare("kicad_mod", Qt::CaseInsensitive) == 0)
+            {
+                list.append(info.completeBaseName());
+            }
+        }
+        return list;
+    }
+
     auto const& kicadFiles = directory.entryInfoList(QStringList() << "*.kicad_mod" , QDir::Files );
 	for (auto const& file : kicadFiles)
 	{
@@ -261,22 +220,21 @@ QStringList FootprintFinder::GetKicadFootprints(QString const& url) const
     return list;
 }
 
-bool FootprintFinder::FixFootprints(QString const& libfolder)
+std::vector<LibraryTableChange> FootprintFinder::PlanFootprintFix(QString const& libfolder)
 {
-    bool worked{false};
     /*
         Three Steps of "fixing" footprints
         1) Convert absolute paths to relative paths in Footprint Table
         2) Find librarys in library folder and add Footprint Table
         3) IDK 
     */
-    if (missingFootprintList.empty())
-    {
-        CheckSchematics();
-    }    
+
+    //one walk of the library folder serves every lookup below
+    IndexLibraryFolder(libfolder);
+    std::vector<LibraryTableChange> plan;
 
     //find missing libs
-    for (auto& library : libraryList[PROJECT_LIB])
+    for (auto const& library : libraryList[PROJECT_LIB])
     {
         if (library.type == LEGACY_LIB)
         {
@@ -289,9 +247,7 @@ bool FootprintFinder::FixFootprints(QString const& libfolder)
             QString FoundKicdLibPath = FindRecurseFile(libfolder, QStringList(libraryPath.fileName()));
             if (!FoundKicdLibPath.isEmpty())
             {
-                auto newPath{ ConvertToRelativePath(FoundKicdLibPath,libfolder) };
-                library.url = newPath;
-                worked = true;
+                plan.push_back({ LibraryTableChange::Kind::Relink, library.name, library.type, library.url, ConvertToRelativePath(FoundKicdLibPath, libfolder) });
             }
         }
         else if (library.type == KICAD_LIB)
@@ -304,9 +260,7 @@ bool FootprintFinder::FixFootprints(QString const& libfolder)
             QString FoundKicdLibPath = FindRecurseDirectory(libfolder, directory.dirName());
             if (!FoundKicdLibPath.isEmpty())
             {
-                auto newPath{ ConvertToRelativePath(FoundKicdLibPath,libfolder) };
-                library.url = newPath;
-                worked = true;
+                plan.push_back({ LibraryTableChange::Kind::Relink, library.name, library.type, library.url, ConvertToRelativePath(FoundKicdLibPath, libfolder) });
             }
             //QDir dir(file.dir().absolutePath());
             //dir.cdUp();
@@ -314,55 +268,64 @@ bool FootprintFinder::FixFootprints(QString const& libfolder)
             //info.url = ConvertToRelativePath(file.dir().absolutePath(), libFolder);
         }  
     }
-    if (worked)
+
+    PlanRelativePaths(libfolder, plan);
+
+    //a relinked library may already hold the footprint, only search for the rest
+    auto const names = [this](QString const& url, QString const& type) { return GetFootprints(url, type); };
+    for (auto const& footprint : missingFootprintList)
     {
-        QString localLibPath{ m_projectFolder + "/fp-lib-table" };
-        SaveLibraryTable(localLibPath);
+        LibraryTableChange change;
+        if(!PlanResolves(plan, footprint, names) && AttemptToFindFootprintPath(footprint, libfolder, change))
+        {
+            plan.push_back(change);
+        }
+    }
 
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
+    ReleaseLibraryFolder();
+    return plan;
+}
+
+std::size_t FootprintFinder::PreviewFootprintFix(QString const& libfolder)
+{
+    if (missingFootprintList.empty())
+    {
         CheckSchematics();
     }
-    worked = false;
-
-    if (ConvertAllPathsToRelative(libfolder))
+    auto const plan{ PlanFootprintFix(libfolder) };
+    for (auto const& change : plan)
     {
-        QString localLibPath{ m_projectFolder + "/fp-lib-table" };
-        SaveLibraryTable(localLibPath);
+        emit SendResult(change.asString(), false);
+    }
+    emit SendResult(QString("Preview: %1 footprint library table changes").arg(plan.size()), false);
+    return plan.size();
+}
 
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
+bool FootprintFinder::FixFootprints(QString const& libfolder)
+{
+    if (missingFootprintList.empty())
+    {
         CheckSchematics();
     }
 
-    for (auto const& footprint : missingFootprintList)
+    //every table change is planned first, then written once and checked once
+    auto const plan{ PlanFootprintFix(libfolder) };
+    for (auto const& change : plan)
     {
-        if(AttemptToFindFootprintPath(footprint, libfolder))
-        {
-            worked = true;
-        }
+        emit SendMessage(change.asString(), spdlog::level::level_enum::info, QString());
     }
 
-    if(worked)
+    if (!ApplyPlan(plan))
     {
-        QString localLibPath {m_projectFolder + "/fp-lib-table"};
-        SaveLibraryTable(localLibPath);
-
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
-        CheckSchematics();
+        return false;
     }
-
-    return worked;
+    //unchanged libraries come from the name cache, only the missing footprints of changed ones are looked up again
+    CreateFootprintList();
+    RecheckMissing(plan, missingFootprintList, [this](QString const& footprint) { return HasFootprint(footprint); });
+    return true;
 }
 
-bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QString const& libraryPath )
+bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QString const& libraryPath, LibraryTableChange& change) const
 {
     if(!footprint.contains(":"))
     {
@@ -392,7 +355,7 @@ bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QStri
             auto newPath{ConvertToRelativePath(prettyPath.absolutePath(),libraryPath )};
 
             emit SendMessage(QString("Found '%1' footprint in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, prettyPath.absolutePath());
-            AddLibraryPath(parts[0], KICAD_LIB, newPath, PROJECT_LIB);
+            change = PlanLibrary(parts[0], KICAD_LIB, newPath);
             return true;
         }
 
@@ -400,15 +363,15 @@ bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QStri
         if(!FoundKicdLibPath.isEmpty())
         {
             //legacy
-            auto Footprints = GetLegacyFootprints(FoundKicdLibPath);
-            if(Footprints.contains(parts[1]))
+            auto const library{ m_legacyIndex->Footprints(FoundKicdLibPath) };
+            if(library && library->contains(parts[1]))
             {
                 //found something
                 //convert to relative path
                 //add to library file
                 auto newPath{ConvertToRelativePath(FoundKicdLibPath,libraryPath)};
                 emit SendMessage(QString("Found '%1' footprint in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-                AddLibraryPath(parts[0], LEGACY_LIB, newPath,PROJECT_LIB);
+                change = PlanLibrary(parts[0], LEGACY_LIB, newPath);
                 return true;
             }
         }
@@ -425,7 +388,7 @@ bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QStri
         auto newPath{ConvertToRelativePath(prettyPath.absolutePath(),libraryPath )};
 
         emit SendMessage(QString("Found '%1' footprint in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, prettyPath.absolutePath());
-        AddLibraryPath(parts[0], KICAD_LIB, newPath, PROJECT_LIB);
+        change = PlanLibrary(parts[0], KICAD_LIB, newPath);
         return true;
     }
 
@@ -434,15 +397,15 @@ bool FootprintFinder::AttemptToFindFootprintPath(QString const& footprint, QStri
     if(!FoundKicdLibPath.isEmpty())
     {
         //legacy
-        auto Footprints = GetLegacyFootprints(FoundKicdLibPath);
-        if(Footprints.contains(parts[1]))
+        auto const library{ m_legacyIndex->Footprints(FoundKicdLibPath) };
+        if(library && library->contains(parts[1]))
         {
             //found something
             //convert to relative path
             //add to library file
             auto newPath{ConvertToRelativePath(FoundKicdLibPath,libraryPath)};
             emit SendMessage(QString("Found '%1' footprint in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-            AddLibraryPath(parts[0], LEGACY_LIB, newPath,PROJECT_LIB);
+            change = PlanLibrary(parts[0], LEGACY_LIB, newPath);
             return true;
         }
     }
@@ -463,6 +426,38 @@ QStringList FootprintFinder::GetFootprints(QString const& url, QString const& ty
     return QStringList();
 }
 
+std::size_t FootprintFinder::FindDuplicateFootprints()
+{
+    //a library listed in both tables is only read once
+    QSet<QString> seen;
+    std::vector<DuplicateSource> sources;
+    for(auto const& [level,library] : libraryList)
+    {
+        for(auto const& lib : library)
+        {
+            auto const fullPath{ updatePath(lib.url) };
+            if(!QFileInfo::exists(fullPath) || seen.contains(fullPath))
+            {
+                continue;
+            }
+            seen.insert(fullPath);
+
+            if (lib.type == LEGACY_LIB)
+            {
+                sources.push_back({ lib.name, fullPath, LibraryItemFormat::LegacyFootprints });
+            }
+            else if (lib.type == KICAD_LIB)
+            {
+                for (auto const& name : GetKicadFootprints(lib.url))
+                {
+                    sources.push_back({ lib.name, fullPath + "/" + name + ".kicad_mod", LibraryItemFormat::KicadFootprint });
+                }
+            }
+        }
+    }
+    return ReportDuplicates(sources, "footprint");
+}
+
 LibraryInfo FootprintFinder::DecodeLibraryInfo(QString const& path, QString const& libFolder) const
 {
     LibraryInfo info;
@@ -6,6 +6,8 @@
 #include "spdlog/spdlog.h"
 
 #include "library_base.h"
+#include "library_index.h"
+#include "name_matcher.h"
 
 #include <QObject>
 #include <QMap>
@@ -20,7 +22,13 @@ public:
 
 	bool CheckSchematics();
 	bool FixFootprints(QString const& libfolder);
+	//the table changes FixFootprints would make, reported as results, nothing is written
+	std::size_t PreviewFootprintFix(QString const& libfolder);
+	//the table changes for the footprints the last CheckSchematics found missing
+	std::vector<LibraryTableChange> PlanFootprintFix(QString const& libfolder);
 	QStringList GetFootprints(QString const& url, QString const& type) const;
+	//reports footprints of the project and global tables that only differ by name or timestamps
+	std::size_t FindDuplicateFootprints();
 
 private:
 	void SaveLibraryTable(QString const& fileName);
@@ -30,7 +38,7 @@ private:
 
 	LibraryInfo DecodeLibraryInfo(QString const& path, QString const& libFolder) const override;
 
-	void CheckSchematic(QString const& schPath);
+	void CheckSchematic(SheetReport& report) const;
 	void CreateFootprintList();
 
 	bool HasFootprint(QString const& footprint) const;
@@ -38,9 +46,10 @@ private:
 
 	QStringList GetKicadFootprints(QString const& url) const;
 
-	bool AttemptToFindFootprintPath(QString const& footprint, QString const& libraryPath );
+	bool AttemptToFindFootprintPath(QString const& footprint, QString const& libraryPath, LibraryTableChange& change) const;
 
-	QMap<QString,QStringList> footprintList;
+	LibraryIndex footprintIndex;
+	NameMatcher footprintMatcher;
 
 	QStringList missingFootprintList;
 };
@@ -0,0 +1,180 @@
+#include "legacy_indexer.h"
+
+#include "kicad_utils.h"
+#include "mapped_file.h"
+
+#include <QFileInfo>
+
+namespace
+{
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	//line starts with keyword followed by a field separator or the end of the line
+	bool StartsWithKeyword(std::string_view line, std::string_view keyword)
+	{
+		return line.substr(0, keyword.size()) == keyword && (line.size() == keyword.size() || IsSpace(line[keyword.size()]));
+	}
+
+	//second whitespace separated field, quotes removed
+	QString SecondField(std::string_view line)
+	{
+		std::size_t pos{ 0 };
+		while (pos < line.size() && !IsSpace(line[pos]))
+		{
+			++pos;
+		}
+		while (pos < line.size() && IsSpace(line[pos]))
+		{
+			++pos;
+		}
+		std::size_t end{ pos };
+		while (end < line.size() && !IsSpace(line[end]))
+		{
+			++end;
+		}
+		return kicad_utils::CleanQuotes(QString::fromUtf8(line.data() + pos, static_cast<qsizetype>(end - pos)));
+	}
+
+	//calls lineFn(line, offset, next) for every line, next is the offset of the following line
+	template <typename LineFn>
+	void ForEachLine(std::string_view data, LineFn&& lineFn)
+	{
+		std::size_t offset{ 0 };
+		while (offset < data.size())
+		{
+			std::size_t end{ data.find('\n', offset) };
+			std::size_t const next{ end == std::string_view::npos ? data.size() : end + 1 };
+			if (end == std::string_view::npos)
+			{
+				end = data.size();
+			}
+			std::string_view line{ data.substr(offset, end - offset) };
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			lineFn(line, offset, next);
+			offset = next;
+		}
+	}
+
+	//blocks from a begin keyword to an end keyword, the name comes from the begin line or a later nameKeyword line
+	std::vector<LegacyIndexEntry> IndexBlocks(std::string_view data, std::string_view begin, std::string_view end, std::string_view nameKeyword)
+	{
+		std::vector<LegacyIndexEntry> entries;
+		bool open{ false };
+		LegacyIndexEntry entry;
+
+		auto const close = [&](std::size_t next)
+		{
+			entry.length = next - entry.offset;
+			if (!entry.name.isEmpty())
+			{
+				entries.push_back(std::move(entry));
+			}
+			entry = LegacyIndexEntry();
+			open = false;
+		};
+
+		ForEachLine(data, [&](std::string_view line, std::size_t offset, std::size_t next)
+		{
+			if (StartsWithKeyword(line, begin))
+			{
+				if (open)
+				{
+					//a block that never ended stops where the next one starts
+					close(offset);
+				}
+				open = true;
+				entry.offset = offset;
+				entry.name = SecondField(line);
+			}
+			else if (!open)
+			{
+				return;
+			}
+			else if (!nameKeyword.empty() && StartsWithKeyword(line, nameKeyword))
+			{
+				entry.name = SecondField(line);
+			}
+			else if (StartsWithKeyword(line, end))
+			{
+				close(next);
+			}
+		});
+		if (open)
+		{
+			close(data.size());
+		}
+		return entries;
+	}
+}
+
+namespace legacy_indexer
+{
+	std::vector<LegacyIndexEntry> IndexFootprints(std::string_view data)
+	{
+		return IndexBlocks(data, "$MODULE", "$EndMODULE", "Li");
+	}
+
+	std::vector<LegacyIndexEntry> IndexSymbols(std::string_view data)
+	{
+		return IndexBlocks(data, "DEF", "ENDDEF", std::string_view());
+	}
+}
+
+std::shared_ptr<LegacyLibrary const> LegacyIndexCache::Footprints(QString const& path)
+{
+	return Get(path, Kind::Footprints);
+}
+
+std::shared_ptr<LegacyLibrary const> LegacyIndexCache::Symbols(QString const& path)
+{
+	return Get(path, Kind::Symbols);
+}
+
+std::shared_ptr<LegacyLibrary const> LegacyIndexCache::Get(QString const& path, Kind kind)
+{
+	Key const key{ path, kind };
+	QFileInfo const fileData(path);
+	{
+		std::lock_guard<std::mutex> const lock(m_lock);
+		if (auto const found{ m_libraries.find(key) }; found != m_libraries.end())
+		{
+			if (found->second->fileSize() == fileData.size() && found->second->lastModified() == fileData.lastModified())
+			{
+				return found->second;
+			}
+			m_libraries.erase(found);
+		}
+	}
+
+	MappedFile const inFile(path);
+	if (!inFile.isOpen())
+	{
+		return nullptr;
+	}
+
+	auto library{ std::make_shared<LegacyLibrary>() };
+	library->m_entries = kind == Kind::Footprints ? legacy_indexer::IndexFootprints(inFile.data()) : legacy_indexer::IndexSymbols(inFile.data());
+	library->m_names.reserve(static_cast<qsizetype>(library->m_entries.size()));
+	for (auto const& entry : library->m_entries)
+	{
+		library->m_names.insert(entry.name);
+	}
+	library->m_fileSize = fileData.size();
+	library->m_lastModified = fileData.lastModified();
+
+	std::lock_guard<std::mutex> const lock(m_lock);
+	m_libraries[key] = library;
+	return library;
+}
+
+void LegacyIndexCache::Clear()
+{
+	std::lock_guard<std::mutex> const lock(m_lock);
+	m_libraries.clear();
+}
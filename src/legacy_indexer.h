@@ -0,0 +1,70 @@
+#ifndef LEGACY_INDEXER_H
+#define LEGACY_INDEXER_H
+
+#include <QString>
+#include <QDateTime>
+#include <QSet>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//One "$MODULE ... $EndMODULE" or "DEF ... ENDDEF" block of a legacy library, offset/length cover the whole block
+struct LegacyIndexEntry
+{
+	QString name;
+	std::size_t offset{ 0 };
+	std::size_t length{ 0 };
+};
+
+namespace legacy_indexer
+{
+	//footprints of a .mod library, named by their "Li" line like GetLegacyFootprints always did
+	std::vector<LegacyIndexEntry> IndexFootprints(std::string_view data);
+	//symbols of a .lib library, named by the second field of their "DEF" line
+	std::vector<LegacyIndexEntry> IndexSymbols(std::string_view data);
+}
+
+//Block table of one legacy library file as it was on disk when it was indexed
+class LegacyLibrary
+{
+public:
+	std::vector<LegacyIndexEntry> const& entries() const { return m_entries; }
+	bool contains(QString const& name) const { return m_names.contains(name); }
+
+	qint64 fileSize() const { return m_fileSize; }
+	QDateTime const& lastModified() const { return m_lastModified; }
+
+private:
+	friend class LegacyIndexCache;
+
+	std::vector<LegacyIndexEntry> m_entries;
+	QSet<QString> m_names;
+	qint64 m_fileSize{ 0 };
+	QDateTime m_lastModified;
+};
+
+//Keeps indexed legacy libraries until the file changes on disk, so listing and membership checks read a file once
+//Footprints/Symbols may be called from several threads, files are indexed outside the lock
+class LegacyIndexCache
+{
+public:
+	std::shared_ptr<LegacyLibrary const> Footprints(QString const& path);
+	std::shared_ptr<LegacyLibrary const> Symbols(QString const& path);
+	void Clear();
+
+private:
+	enum class Kind { Footprints, Symbols };
+	//the same path read as the other kind has a different block table
+	using Key = std::pair<QString, Kind>;
+
+	std::shared_ptr<LegacyLibrary const> Get(QString const& path, Kind kind);
+
+	std::map<Key, std::shared_ptr<LegacyLibrary const>> m_libraries;
+	std::mutex m_lock;
+};
+
+#endif
@@ -1,19 +1,35 @@
 #include "library_base.h"
 
-#include "kicad_utils.h"
+#include "directory_walker.h"
+#include "mapped_file.h"
+#include "sexpr_tokenizer.h"
 
 #include <QFile>
 #include <QDir>
 #include <QFileInfo>
 #include <QTextStream>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
 
-constexpr std::string_view PROJ_FOLDER = "${KIPRJMOD}";
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 void LibraryBase::LoadProject(QString const& folder)
 {
     libraryList.clear();
     m_projectFolder = folder;
+    m_paths->SetProject(folder);
+    if (m_paths->commonSettings().isEmpty())
+    {
+        emit SendMessage(QString("No kicad_common.json found in '%1'").arg(m_paths->configFolder()), spdlog::level::level_enum::debug, QString());
+    }
+    for (auto const& settings : m_paths->commonSettings())
+    {
+        emit SendMessage(QString("Path variables read from '%1'").arg(settings), spdlog::level::level_enum::debug, settings);
+    }
     getProjectLibraries();
     getGlobalLibraries();
 }
@@ -39,6 +55,146 @@ void LibraryBase::getGlobalLibraries()
     }
 }
 
+std::vector<QStringList> LibraryBase::LoadLibraryNames(std::function<QStringList(LibraryInfo const&)> const& loader)
+{
+    std::vector<LibraryInfo const*> libraries;
+    for (auto const& [level, library] : libraryList)
+    {
+        for (auto const& lib : library)
+        {
+            libraries.push_back(&lib);
+        }
+    }
+
+    std::vector<QStringList> names(libraries.size());
+    std::vector<std::size_t> pending;
+    QSet<QString> nicknames;
+    for (std::size_t i = 0; i < libraries.size(); ++i)
+    {
+        if (nicknames.contains(libraries[i]->name))
+        {
+            continue;
+        }
+        nicknames.insert(libraries[i]->name);
+        auto const fullPath{ updatePath(libraries[i]->url) };
+        if (!m_libraryIndex->Find(fullPath, names[i]) && QFileInfo::exists(fullPath))
+        {
+            pending.push_back(i);
+        }
+    }
+
+    RunParallel(pending.size(), [&](std::size_t job)
+    {
+        names[pending[job]] = loader(*libraries[pending[job]]);
+    });
+
+    for (auto const index : pending)
+    {
+        if (!names[index].empty())
+        {
+            m_libraryIndex->Store(updatePath(libraries[index]->url), names[index]);
+        }
+    }
+    m_libraryIndex->Save();
+    return names;
+}
+
+std::vector<SheetReport> LibraryBase::CheckSheets(QFileInfoList const& files, std::function<void(SheetReport&)> const& check)
+{
+    std::vector<SheetReport> reports(static_cast<std::size_t>(files.size()));
+    RunParallel(reports.size(), [&](std::size_t index)
+    {
+        auto& report{ reports[index] };
+        report.document = m_documents->Get(files[static_cast<qsizetype>(index)].absoluteFilePath());
+        if (report.document)
+        {
+            check(report);
+        }
+    });
+
+    for (std::size_t i = 0; i < reports.size(); ++i)
+    {
+        auto const& file{ files[static_cast<qsizetype>(i)] };
+        emit SendMessage(QString("Checking '%1'").arg(file.fileName()), spdlog::level::level_enum::debug, file.absoluteFilePath());
+        if (!reports[i].document)
+        {
+            emit SendMessage(QString("Could not Open '%1'").arg(file.absoluteFilePath()), spdlog::level::level_enum::warn, file.absoluteFilePath());
+            continue;
+        }
+        for (auto const& [message, error] : reports[i].results)
+        {
+            emit SendResult(message, error);
+        }
+    }
+    return reports;
+}
+
+std::size_t LibraryBase::ReportDuplicates(std::vector<DuplicateSource> const& sources, QString const& kind)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::vector<HashedItem>> hashed(sources.size());
+    RunParallel(sources.size(), [&](std::size_t job)
+    {
+        hashed[job] = duplicate_hasher::HashFile(sources[job].path, sources[job].format);
+    });
+
+    std::size_t items{ 0 };
+    QHash<QByteArray, QStringList> groups;
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        for (auto const& item : hashed[i])
+        {
+            groups[item.hash].append(sources[i].library + ":" + item.name);
+            ++items;
+        }
+    }
+
+    std::vector<QStringList> duplicates;
+    for (auto const& group : groups)
+    {
+        if (group.size() > 1)
+        {
+            duplicates.push_back(group);
+        }
+    }
+    std::sort(duplicates.begin(), duplicates.end(), [](QStringList const& lhs, QStringList const& rhs) { return lhs.front() < rhs.front(); });
+
+    for (auto const& group : duplicates)
+    {
+        emit SendResult(QString("Same %1: %2").arg(kind).arg(group.join(", ")), false);
+    }
+    emit SendResult(QString("Found %1 duplicate groups in %2 %3s").arg(duplicates.size()).arg(items).arg(kind), false);
+    emit SendMessage(QString("Hashed %1 %2s in %3 files in %4 ms").arg(items).arg(kind).arg(sources.size()).arg(timer.elapsed()), spdlog::level::level_enum::debug, QString());
+    return duplicates.size();
+}
+
+void LibraryBase::RunParallel(std::size_t count, std::function<void(std::size_t)> const& job)
+{
+    //each worker takes the next index, results land in caller-owned slots so the merge order never changes
+    std::atomic<std::size_t> next{ 0 };
+    auto const work = [&]()
+    {
+        for (auto index{ next++ }; index < count; index = next++)
+        {
+            job(index);
+        }
+    };
+
+    std::size_t const threadCount{ std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), count) };
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
 QString LibraryBase::getGlobalKicadDataPath() const
 {
 #if defined( Q_OS_DARWIN )
@@ -84,25 +240,125 @@ QString LibraryBase::getGlobalSymbolTablePath() const
 
 QString LibraryBase::updatePath(QString path) const
 {
-    path = path.replace("${KICAD6_FOOTPRINT_DIR}", getGlobalFootprintPath() );
-    path = path.replace("${KICAD6_SYMBOL_DIR}", getGlobalSymbolPath());
-    path = path.replace(PROJ_FOLDER.data(), m_projectFolder);
-    return path;
+    return m_paths->Resolve(path);
+}
+
+LibraryTableChange LibraryBase::PlanLibrary(QString const& name, QString const& type, QString const& url) const
+{
+    LibraryTableChange change{ LibraryTableChange::Kind::Add, name, type, QString(), url };
+    if (auto const found{ libraryList.find(PROJECT_LIB) }; found != libraryList.end())
+    {
+        for (auto const& lib : found->second)
+        {
+            if (lib.name == name)
+            {
+                change.kind = LibraryTableChange::Kind::Update;
+                change.oldUrl = lib.url;
+                break;
+            }
+        }
+    }
+    return change;
+}
+
+void LibraryBase::PlanRelativePaths(QString const& libraryPath, std::vector<LibraryTableChange>& plan) const
+{
+    auto const found{ libraryList.find(PROJECT_LIB) };
+    if (found == libraryList.end())
+    {
+        return;
+    }
+
+    for (auto const& lib : found->second)
+    {
+        if (std::any_of(plan.begin(), plan.end(), [&](auto const& change) { return change.name == lib.name; }))
+        {
+            continue;
+        }
+        auto newPath{ ConvertToRelativePath(lib.url, libraryPath) };
+        if (newPath.compare(lib.url) != 0)
+        {
+            plan.push_back({ LibraryTableChange::Kind::Relative, lib.name, lib.type, lib.url, newPath });
+        }
+    }
+}
+
+bool LibraryBase::PlanResolves(std::vector<LibraryTableChange> const& plan, QString const& item, std::function<QStringList(QString const&, QString const&)> const& names) const
+{
+    if (!item.contains(":"))
+    {
+        return false;
+    }
+    auto const parts{ item.split(":") };
+    for (auto const& change : plan)
+    {
+        if (change.name != parts[0])
+        {
+            continue;
+        }
+        //a relative path points at the same files, so the item is still missing
+        if (change.kind == LibraryTableChange::Kind::Relative)
+        {
+            return false;
+        }
+        //first library found for a name wins, an added, updated or relinked one only counts if it has the item
+        return names(change.newUrl, change.type).contains(parts[1]);
+    }
+    return false;
+}
+
+bool LibraryBase::ApplyPlan(std::vector<LibraryTableChange> const& plan)
+{
+    if (plan.empty())
+    {
+        return false;
+    }
+
+    for (auto const& change : plan)
+    {
+        if (change.kind == LibraryTableChange::Kind::Add || change.kind == LibraryTableChange::Kind::Update)
+        {
+            AddLibraryPath(change.name, change.type, change.newUrl, PROJECT_LIB);
+            continue;
+        }
+        for (auto& lib : libraryList[PROJECT_LIB])
+        {
+            if (lib.name == change.name)
+            {
+                lib.url = change.newUrl;
+            }
+        }
+    }
+
+    SaveLibraryTable(getProjectLibraryPath());
+    emit SendClearLibrary(PROJECT_LIB);
+    libraryList[PROJECT_LIB].clear();
+    getProjectLibraries();
+    emit SendClearResults();
+    return true;
 }
 
-bool LibraryBase::ConvertAllPathsToRelative(QString const& libraryPath)
+void LibraryBase::RecheckMissing(std::vector<LibraryTableChange> const& plan, QStringList& missing, std::function<bool(QString const&)> const& has) const
 {
-    bool worked{ false };
-    for (auto& path : libraryList[PROJECT_LIB])
+    QSet<QString> changed;
+    for (auto const& change : plan)
+    {
+        changed.insert(change.name);
+    }
+
+    for (auto it{ missing.begin() }; it != missing.end();)
     {
-        auto newPath{ ConvertToRelativePath(path.url, libraryPath) };
-        if (newPath.compare(path.url) != 0)
+        //ApplyPlan cleared the results, items of untouched libraries are still missing without a lookup
+        QString const library{ it->section(':', 0, 0) };
+        if (it->contains(':') && changed.contains(library) && has(*it))
         {
-            path.url = newPath;
-            worked = true;
+            emit SendResult(QString("'%1' was found in '%2'").arg(*it).arg(library), false);
+            it = missing.erase(it);
+            continue;
         }
+        emit SendResult(QString("'%1' is still missing").arg(*it), true);
+        ++it;
     }
-    return worked;
 }
 
 void LibraryBase::AddLibraryPath(QString name, QString type, QString url, QString const& level)
@@ -223,276 +479,144 @@ void LibraryBase::ImportLibrary(QString const& path, QString const& libFolder)
 
 void LibraryBase::ParseLibraries(QString const& path, QString const& level)
 {
-    QFile inFile(path);
+    MappedFile const inFile(path);
 
-    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!inFile.isOpen())
     {
         emit SendMessage(QString("Could not Open '%1'").arg(path), spdlog::level::level_enum::warn, path);
         return;
     }
-    QTextStream in(&inFile);
-    while (!in.atEnd())
+
+    //  (lib (name "Device")(type "KiCad")(uri "${KICAD6_SYMBOL_DIR}/Device.kicad_sym")(options "")(descr "Generic symbols"))
+    SexprTokenizer tokens(inFile.data());
+    for (auto token{ tokens.Next() }; !token.isEnd(); token = tokens.Next())
     {
-        QString line = in.readLine();
-        QString name = getLibParamter("name", line);
-        QString type = getLibParamter("type", line);
-        QString uri = getLibParamter("uri", line);
-        QString options = getLibParamter("options", line);
-        QString descr = getLibParamter("descr", line);
+        if (!token.isOpen() || !tokens.Peek().isAtom("lib"))
+        {
+            continue;
+        }
+        tokens.Next();
+
+        QString name;
+        QString type;
+        QString uri;
+        QString options;
+        QString descr;
+        for (auto item{ tokens.Next() }; !item.isClose() && !item.isEnd(); item = tokens.Next())
+        {
+            if (!item.isOpen())
+            {
+                continue;
+            }
+            auto const key{ tokens.Next() };
+            auto const value{ tokens.Next() };
+            if (value.isClose())
+            {
+                continue;
+            }
+            if (key.isAtom("name"))
+            {
+                name = value.toQString();
+            }
+            else if (key.isAtom("type"))
+            {
+                type = value.toQString();
+            }
+            else if (key.isAtom("uri"))
+            {
+                uri = value.toQString();
+            }
+            else if (key.isAtom("options"))
+            {
+                options = value.toQString();
+            }
+            else if (key.isAtom("descr"))
+            {
+                descr = value.toQString();
+            }
+            else if (value.isOpen())
+            {
+                tokens.SkipList();
+            }
+            tokens.SkipList();
+        }
+
         if (!name.isEmpty() && !type.isEmpty() && !uri.isEmpty())
         {
             emit SendAddLibrary(level, name, type, descr, uri);
             libraryList[level].emplace_back(name, type, uri, options, descr);
         }
     }
-    inFile.close();
-}
-
-QString LibraryBase::getSchFootprint(QString const& line ) const
-{
-    QString prop(R"((property "Footprint")");
-    int stInd =  line.indexOf(prop );
-
-    if(stInd == -1 )
-    {
-         return QString();
-    }
-    int endInd =  line.indexOf("(",stInd + 1 );
-
-    if(stInd == endInd || stInd ==-1 || endInd == -1)
-    {
-        return QString();
-    }
-    int nstr = stInd + prop.size() + 1;
-    QString value = line.mid(nstr, endInd - nstr - 1);
-
-    value = kicad_utils::CleanQuotes(value);
-    return value;
-}
-
-QString LibraryBase::getSchReference(QString const& line ) const
-{
-    QString prop(R"((property "Reference")");
-    int stInd =  line.indexOf(prop );
-
-    if(stInd == -1 )
-    {
-         return QString();
-    }
-    int endInd =  line.indexOf("(",stInd + 1 );
-
-    if(stInd == endInd || stInd ==-1 || endInd == -1)
-    {
-        return QString();
-    }
-    int nstr = stInd + prop.size() + 1;
-    QString value = line.mid(nstr, endInd - nstr - 1);
-
-    value = kicad_utils::CleanQuotes(value);
-    return value;
-}
-
-QString LibraryBase::getSchSymbol(QString const& line ) const
-{
-    QString prop(R"((symbol (lib_id )");
-    int stInd =  line.indexOf(prop );
-
-    if(stInd == -1 )
-    {
-         return QString();
-    }
-    int endInd =  line.indexOf(")",stInd + 1 );
-
-    if(stInd == endInd || stInd ==-1 || endInd == -1)
-    {
-        return QString();
-    }
-    int nstr = stInd + prop.size() + 1;
-    QString value = line.mid(nstr, endInd - nstr - 1);
-
-    value = kicad_utils::CleanQuotes(value);
-    return value;
-}
-
-QString LibraryBase::getLibSymbol(QString const& line ) const
-{
-    QString prop(R"((symbol )");
-    int stInd =  line.indexOf(prop );
-
-    if(stInd == -1 )
-    {
-         return QString();
-    }
-    int endInd =  line.indexOf("(",stInd + 1 );
-
-    if(stInd == endInd || stInd ==-1 || endInd == -1)
-    {
-        return QString();
-    }
-    int nstr = stInd + prop.size() + 1;
-    QString value = line.mid(nstr, endInd - nstr - 1);
-
-    value = kicad_utils::CleanQuotes(value);
-    return value;
-}
-
-QString LibraryBase::getLibParamter(QString const& parm, QString const& line ) const
-{
-    int stInd =  line.indexOf("(" + parm );
-    int endInd =  line.indexOf(")",stInd );
-
-    if(stInd == endInd || stInd ==-1 || endInd == -1)
-    {
-        return QString();
-    }
-    int nstr = stInd + parm.length() + 2;
-    QString value = line.mid(nstr, endInd - nstr);
-
-    value = kicad_utils::CleanQuotes(value);
-    return value;
 }
 
 QString LibraryBase::ConvertToRelativePath(QString const& ogpath, QString const& libraryPath) const
 {
-    //if already using macros, avoid
-    if(ogpath.startsWith("$"))
-    {
-        return ogpath;
-    }
-
-    if(libraryPath.isEmpty())
+    auto const path{ m_paths->Relative(ogpath, libraryPath) };
+    if(path != ogpath)
     {
-        return ogpath;
-    }
-
-    auto path{ogpath};
-     //if its in a subfolder, easy to do find replace
-    if(path.startsWith(m_projectFolder))
-    {
-        path = path.replace(m_projectFolder, PROJ_FOLDER.data());
         emit SendMessage(QString("Converted '%1' to '%2'").arg( ogpath ).arg(path), spdlog::level::level_enum::debug, QString());
-        return path;
     }
+    return path;
+}
 
-    auto startProject{m_projectFolder};
-    auto startLibrary{libraryPath};
-
-    QString startLibRelative{QString(PROJ_FOLDER.data()) + "/"};//list of slashes going up the folder structure
-    QString folders;                        //list of folders  going down the folder structure
-
-    bool worked{false};
-    for(int i = 0; i < 255; ++i)//avoid infinite loops
+void LibraryBase::IndexLibraryFolder(QString const& folder)
+{
+    if (m_liveFolderIndex && m_liveFolderIndex->Covers(folder))
     {
-        int netProjSlash = startProject.lastIndexOf("/");
-        int netLibSlash = startLibrary.lastIndexOf("/");
-        if(-1 == netProjSlash || -1 == netLibSlash)
+        if (!m_liveFolderIndex->watched())
         {
-            break;
-        }
-
-        QString const folder = startLibrary.right(startLibrary.size() - (netLibSlash + 1));
-        startLibRelative += "../";
-        folders += folder;
-        folders += "/";
-
-        //get next directory up the folder structure
-        startProject = startProject.left(netProjSlash);
-        startLibrary = startLibrary.left(netLibSlash);
-
-        //if commom, we are done
-        if(startLibrary.startsWith(startProject))
-        {
-            worked = true;
-            break;
+            if (int const changed{ m_liveFolderIndex->Revalidate() }; changed > 0)
+            {
+                emit SendMessage(QString("Re-read %1 changed folders in '%2'").arg(changed).arg(m_liveFolderIndex->root()), spdlog::level::level_enum::debug, m_liveFolderIndex->root());
+            }
         }
+        m_folderIndex = m_liveFolderIndex;
+        return;
     }
-    if (worked)
-    {
-        QString newFolder = startLibRelative + folders;//added up and downs paths together
-        path = path.replace(libraryPath + "/", newFolder);
-        emit SendMessage(QString("Converted '%1' to '%2'").arg( ogpath ).arg(path), spdlog::level::level_enum::debug, QString());
-        return path;
-    }
-    return path;
+    m_folderIndex = std::make_shared<LibraryFolderIndex>(folder);
 }
 
 QString LibraryBase::FindRecurseDirectory(const QString& startDir, const QString& dirName) const
 {
-	QDir dir(startDir);
-	QFileInfoList list = dir.entryInfoList();
-	for (int iList = 0;iList<list.count();iList++)
-	{
-		QFileInfo info = list[iList];
- 
-		QString sFilePath = info.filePath();
-		if (info.isDir())
-		{
-            if( info.completeBaseName().compare(dirName) == 0)
-            {
-                return info.filePath();
-            }
-			// recursive
-			if (info.fileName()!=".." && info.fileName()!=".")
-			{
-                auto const& path{FindRecurseDirectory(sFilePath, dirName)};
-                if(!path.isEmpty())
-                {
-                    return path;
-                }
-			}
-		}
-	}
-    return QString();
+    if (m_folderIndex && m_folderIndex->Covers(startDir))
+    {
+        return m_folderIndex->FindDirectory(startDir, dirName);
+    }
+
+    WalkOptions options;
+    options.files = false;
+    options.stopAtFirst = true;
+    options.matchDir = [&](QString const& name) { return QFileInfo(name).completeBaseName() == dirName; };
+    auto const found{ directory_walker::Walk(startDir, options) };
+    return found.isEmpty() ? QString() : found.first();
 }
 
 QString LibraryBase::FindRecurseFile(const QString& startDir, const QStringList& fileNames) const
 {
-	QDir dir(startDir);
-	dir.setNameFilters(fileNames);
-    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
-
-    auto const& fileList { dir.entryInfoList()};
-    if(fileList.count()>0)
+    if (m_folderIndex && m_folderIndex->Covers(startDir))
     {
-        return fileList[0].filePath();
+        return m_folderIndex->FindFile(startDir, fileNames);
     }
 
-    dir.setFilter(QDir::AllDirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
-    QStringList dirList = dir.entryList();
-    for (int i=0; i<dirList.size(); ++i)
-    {
-        QString newPath = QString("%1/%2").arg(dir.absolutePath()).arg(dirList.at(i));
-        QString path{FindRecurseFile(newPath, fileNames)};
-        if(!path.isEmpty())
-        {
-            return path;
-        }
-    }
-    return QString();
+    WalkOptions options;
+    options.nameFilters = fileNames;
+    options.stopAtFirst = true;
+    auto const found{ directory_walker::Walk(startDir, options) };
+    return found.isEmpty() ? QString() : found.first();
 }
 
-QStringList LibraryBase::FindRecurseFiles(const QString& startDir, const QStringList& fileNames) const
+QStringList LibraryBase::FindRecurseFiles(const QString& startDir, const QStringList& fileNames, QStringList* folders) const
 {
-    QStringList returnList;
-	QDir dir(startDir);
-	dir.setNameFilters(fileNames);
-    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
-
-    for(auto const& file : dir.entryInfoList())
+    if (m_folderIndex && m_folderIndex->Covers(startDir))
     {
-         returnList.append(file.filePath());
-    }
-
-    dir.setFilter(QDir::AllDirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
-    QStringList dirList = dir.entryList();
-    for (int i=0; i<dirList.size(); ++i)
-    {
-        QString newPath = QString("%1/%2").arg(dir.absolutePath()).arg(dirList.at(i));
-        auto paths{FindRecurseFiles(newPath, fileNames)};
-        if(!paths.isEmpty())
+        if (folders != nullptr)
         {
-            returnList.append(paths);
+            *folders = m_folderIndex->Directories(startDir);
         }
+        return m_folderIndex->FindFiles(startDir, fileNames);
     }
-    return returnList;
+
+    WalkOptions options;
+    options.nameFilters = fileNames;
+    return directory_walker::Walk(startDir, options, folders);
 }
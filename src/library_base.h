@@ -3,10 +3,20 @@
 
 #include "spdlog/spdlog.h"
 
+#include "duplicate_hasher.h"
+#include "legacy_indexer.h"
 #include "library_info.h"
+#include "library_folder_index.h"
+#include "library_index_cache.h"
+#include "path_resolver.h"
+#include "schematic_document.h"
 
 #include <QObject>
+#include <QFileInfo>
+#include <functional>
 #include <map>
+#include <memory>
+#include <vector>
 
 constexpr const char* PROJECT_LIB = "Project";
 constexpr const char* GLOBAL_LIB = "Global";
@@ -16,6 +26,23 @@ constexpr const char* KICAD_LIB = "KiCad";
 
 //constexpr std::string_view PROJ_FOLDER = "${KIPRJMOD}";
 
+//Everything one sheet check reports, buffered so sheets checked in parallel are emitted in file order
+struct SheetReport
+{
+	std::shared_ptr<SchematicDocument const> document;
+	std::vector<std::pair<QString, bool>> results;	//SendResult message, error
+	QStringList missing;
+	QStringList rescue;
+};
+
+//One library file read by the duplicate scan
+struct DuplicateSource
+{
+	QString library;
+	QString path;
+	LibraryItemFormat format{ LibraryItemFormat::KicadFootprint };
+};
+
 class LibraryBase : public QObject
 {
 Q_OBJECT
@@ -24,7 +51,11 @@ public:
 	LibraryBase() {}
     virtual ~LibraryBase() {}
 
+	//expands every ${VAR} of path, see PathResolver
 	QString updatePath(QString path) const;
+	void SetDocumentCache(std::shared_ptr<SchematicDocumentCache> documents) { m_documents = std::move(documents); }
+	void SetIndexCache(std::shared_ptr<LibraryIndexCache> index) { m_libraryIndex = std::move(index); }
+	void SetFolderIndex(std::shared_ptr<LibraryFolderIndex> index) { m_liveFolderIndex = std::move(index); }
 	virtual void LoadProject(QString const& folder);
 
 	virtual void ChangeLibraryName(QString const& oldName, QString const& newName, int row);
@@ -52,6 +83,19 @@ protected:
 	virtual QString getProjectLibraryPath() const = 0;
 	virtual QString getGlobalLibraryPath() const = 0;
 
+	//names of every entry of libraryList in iteration order, cache misses are loaded on a thread pool
+	//missing libraries are left empty so the caller reports them on this thread,
+	//as are later entries of a nickname, those are only loaded by the caller when the first one failed
+	std::vector<QStringList> LoadLibraryNames(std::function<QStringList(LibraryInfo const&)> const& loader);
+
+	//runs check on every sheet in parallel, then emits the reports in the order of files
+	std::vector<SheetReport> CheckSheets(QFileInfoList const& files, std::function<void(SheetReport&)> const& check);
+	//hashes every item of sources in parallel and reports the "Lib:Item" groups with the same content
+	//returns the number of duplicate groups
+	std::size_t ReportDuplicates(std::vector<DuplicateSource> const& sources, QString const& kind);
+	//job(0..count-1) on up to one thread per core, the calling thread takes part
+	static void RunParallel(std::size_t count, std::function<void(std::size_t)> const& job);
+
 	void getProjectLibraries();
 	void getGlobalLibraries();
 
@@ -64,24 +108,39 @@ protected:
 	QString getGlobalFootprintTablePath() const;
 	QString getGlobalSymbolTablePath() const;
 
+	//while a folder is indexed, FindRecurseFile/FindRecurseDirectory below it answer from memory
+	//the watched index from SetFolderIndex is reused when it covers folder
+	void IndexLibraryFolder(QString const& folder);
+	void ReleaseLibraryFolder() { m_folderIndex.reset(); }
+
 	QString FindRecurseDirectory(const QString& startDir, const QString& dirName) const;
 	QString FindRecurseFile(const QString& startDir, const QStringList& fileName) const;
-	QStringList FindRecurseFiles(const QString& startDir, const QStringList& fileNames) const;
+	//folders gets startDir and every folder below it that was looked at
+	QStringList FindRecurseFiles(const QString& startDir, const QStringList& fileNames, QStringList* folders = nullptr) const;
 
 	QString ConvertToRelativePath(QString const& ogpath, QString const& libraryPath) const;
 
-	QString getSchSymbol(QString const& line ) const;
-	QString getSchFootprint(QString const& line ) const;
-	QString getSchReference(QString const& line ) const;
-	QString getLibSymbol(QString const& line ) const;
-
-	QString getLibParamter(QString const& parm, QString const& line ) const;
-
-	bool ConvertAllPathsToRelative(QString const& libraryPath);
+	//Add or Update of name in the project table, nothing is changed until ApplyPlan
+	LibraryTableChange PlanLibrary(QString const& name, QString const& type, QString const& url) const;
+	//absolute project paths that aren't already touched by plan
+	void PlanRelativePaths(QString const& libraryPath, std::vector<LibraryTableChange>& plan) const;
+	//true when item ("Lib:Name") is already taken care of by plan, names lists a library by url/type
+	bool PlanResolves(std::vector<LibraryTableChange> const& plan, QString const& item, std::function<QStringList(QString const&, QString const&)> const& names) const;
+	//applies the whole plan, writes the table once and reloads the project libraries
+	bool ApplyPlan(std::vector<LibraryTableChange> const& plan);
+	//after ApplyPlan only the missing items of libraries named in plan are looked up again, sheets aren't re-read
+	//has answers from the rebuilt name index, items it finds are dropped from missing, the rest is reported again
+	void RecheckMissing(std::vector<LibraryTableChange> const& plan, QStringList& missing, std::function<bool(QString const&)> const& has) const;
 
 	void AddLibraryPath(QString name, QString type, QString url, QString const& level);
 
 	QString m_projectFolder;
+	std::shared_ptr<PathResolver> m_paths{ std::make_shared<PathResolver>(getGlobalKicadDataPath()) };
+	std::shared_ptr<SchematicDocumentCache> m_documents{ std::make_shared<SchematicDocumentCache>() };
+	std::shared_ptr<LibraryIndexCache> m_libraryIndex{ std::make_shared<LibraryIndexCache>() };
+	std::shared_ptr<LegacyIndexCache> m_legacyIndex{ std::make_shared<LegacyIndexCache>() };
+	std::shared_ptr<LibraryFolderIndex> m_folderIndex;
+	std::shared_ptr<LibraryFolderIndex> m_liveFolderIndex;
 
 	std::map<QString, std::vector<LibraryInfo>> libraryList;
 };
@@ -0,0 +1,362 @@
+#include "library_folder_index.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace
+{
+	void Drop(QHash<QString, QSet<QString>>& hash, QString const& key, QString const& path)
+	{
+		auto const found{ hash.find(key) };
+		if (found == hash.end())
+		{
+			return;
+		}
+		found->remove(path);
+		if (found->isEmpty())
+		{
+			hash.erase(found);
+		}
+	}
+
+	//QDir's default Name | IgnoreCase ordering
+	int CompareNames(QString const& lhs, QString const& rhs)
+	{
+		int const result{ QString::compare(lhs, rhs, Qt::CaseInsensitive) };
+		return result != 0 ? result : QString::compare(lhs, rhs, Qt::CaseSensitive);
+	}
+}
+
+LibraryFolderIndex::LibraryFolderIndex(QString const& root, std::atomic<bool> const* stop) :
+	m_root(Clean(root)),
+	m_stop(stop)
+{
+	Walk(m_root);
+	m_stop = nullptr;
+}
+
+QString LibraryFolderIndex::Clean(QString const& dir)
+{
+	return QDir::cleanPath(QDir(dir).absolutePath());
+}
+
+bool LibraryFolderIndex::IsBelow(QString const& path, QString const& startDir)
+{
+	return path.startsWith(startDir + "/");
+}
+
+bool LibraryFolderIndex::Covers(QString const& dir) const
+{
+	QString const path{ Clean(dir) };
+	return path == m_root || IsBelow(path, m_root);
+}
+
+void LibraryFolderIndex::Walk(QString const& dir)
+{
+	//same listing as FindRecurseFile: a folder's files first, then each sub folder in name order
+	if (m_stop && *m_stop)
+	{
+		return;
+	}
+	if (!QDir(dir).exists())
+	{
+		return;
+	}
+
+	Folder folder{ Read(dir) };
+	AddFiles(folder);
+	for (auto const& sub : folder.dirs)
+	{
+		m_dirNames[QFileInfo(sub).completeBaseName()].insert(sub);
+	}
+
+	QStringList const subDirs{ folder.dirs };
+	m_folders[dir] = std::move(folder);
+	for (auto const& sub : subDirs)
+	{
+		Walk(sub);
+	}
+}
+
+LibraryFolderIndex::Folder LibraryFolderIndex::Read(QString const& dir)
+{
+	QDir directory(dir);
+	Folder folder;
+	folder.modified = QFileInfo(dir).lastModified();
+	directory.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+	for (auto const& file : directory.entryInfoList())
+	{
+		folder.files.append(file.absoluteFilePath());
+	}
+
+	directory.setFilter(QDir::AllDirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+	for (auto const& sub : directory.entryInfoList())
+	{
+		folder.dirs.append(sub.absoluteFilePath());
+	}
+	return folder;
+}
+
+void LibraryFolderIndex::AddFiles(Folder const& folder)
+{
+	for (auto const& path : folder.files)
+	{
+		QFileInfo const file(path);
+		m_fileNames[file.fileName().toLower()].insert(path);
+		m_suffixes[file.suffix().toLower()].insert(path);
+	}
+}
+
+void LibraryFolderIndex::DropFiles(Folder const& folder)
+{
+	for (auto const& path : folder.files)
+	{
+		QFileInfo const file(path);
+		Drop(m_fileNames, file.fileName().toLower(), path);
+		Drop(m_suffixes, file.suffix().toLower(), path);
+	}
+}
+
+void LibraryFolderIndex::Remove(QString const& dir)
+{
+	for (auto it{ m_folders.lower_bound(dir) }; it != m_folders.end() && it->first.startsWith(dir);)
+	{
+		if (it->first != dir && !IsBelow(it->first, dir))
+		{
+			++it;
+			continue;
+		}
+		DropFiles(it->second);
+		for (auto const& path : it->second.dirs)
+		{
+			Drop(m_dirNames, QFileInfo(path).completeBaseName(), path);
+		}
+		it = m_folders.erase(it);
+	}
+}
+
+void LibraryFolderIndex::Relist(QString const& dir, QStringList& added, QStringList& removed)
+{
+	QString const path{ Clean(dir) };
+	auto const found{ m_folders.find(path) };
+	if (found == m_folders.end())
+	{
+		//not indexed yet, the parent's listing picks it up as a new folder
+		return;
+	}
+	if (!QDir(path).exists())
+	{
+		//the parent's listing drops its name
+		removed.append(Directories(path));
+		Remove(path);
+		return;
+	}
+
+	Folder current{ Read(path) };
+	DropFiles(found->second);
+	AddFiles(current);
+
+	QSet<QString> const before(found->second.dirs.begin(), found->second.dirs.end());
+	QSet<QString> const after(current.dirs.begin(), current.dirs.end());
+	for (auto const& sub : found->second.dirs)
+	{
+		if (!after.contains(sub))
+		{
+			removed.append(Directories(sub));
+			Remove(sub);
+			Drop(m_dirNames, QFileInfo(sub).completeBaseName(), sub);
+		}
+	}
+	QStringList newDirs;
+	for (auto const& sub : current.dirs)
+	{
+		if (!before.contains(sub))
+		{
+			m_dirNames[QFileInfo(sub).completeBaseName()].insert(sub);
+			newDirs.append(sub);
+		}
+	}
+	//Remove/Walk only erase or insert other folders, found stays valid
+	found->second = std::move(current);
+	for (auto const& sub : newDirs)
+	{
+		Walk(sub);
+		added.append(Directories(sub));
+	}
+}
+
+int LibraryFolderIndex::Revalidate()
+{
+	//adding, removing or renaming an entry changes the mtime of the folder holding it
+	QStringList changed;
+	for (auto const& [path, folder] : m_folders)
+	{
+		if (QFileInfo(path).lastModified() != folder.modified)
+		{
+			changed.append(path);
+		}
+	}
+
+	QStringList added;
+	QStringList removed;
+	for (auto const& path : changed)
+	{
+		Relist(path, added, removed);
+	}
+	return static_cast<int>(changed.size());
+}
+
+QStringList LibraryFolderIndex::Directories(QString const& dir) const
+{
+	QString const path{ Clean(dir) };
+	QStringList dirs;
+	for (auto it{ m_folders.lower_bound(path) }; it != m_folders.end() && it->first.startsWith(path); ++it)
+	{
+		if (it->first == path || IsBelow(it->first, path))
+		{
+			dirs.append(it->first);
+		}
+	}
+	return dirs;
+}
+
+bool LibraryFolderIndex::ListFiles(QString const& dir, QStringList& files) const
+{
+	auto const found{ m_folders.find(Clean(dir)) };
+	if (found == m_folders.end())
+	{
+		return false;
+	}
+	files = found->second.files;
+	return true;
+}
+
+QStringList LibraryFolderIndex::Matches(QString const& fileName) const
+{
+	if (!fileName.contains('*') && !fileName.contains('?'))
+	{
+		return m_fileNames.value(fileName.toLower()).values();
+	}
+
+	//globs like "Device*.lib" only have to look at files with that suffix
+	QRegularExpression const pattern(QRegularExpression::wildcardToRegularExpression(fileName), QRegularExpression::CaseInsensitiveOption);
+	QString const suffix{ fileName.section('.', -1).toLower() };
+	bool const plainSuffix{ fileName.contains('.') && !suffix.contains('*') && !suffix.contains('?') };
+
+	QStringList found;
+	auto const check = [&](QString const& path)
+	{
+		if (pattern.match(QFileInfo(path).fileName()).hasMatch())
+		{
+			found.append(path);
+		}
+	};
+	if (plainSuffix)
+	{
+		for (auto const& path : m_suffixes.value(suffix))
+		{
+			check(path);
+		}
+	}
+	else
+	{
+		for (auto const& [dir, folder] : m_folders)
+		{
+			for (auto const& path : folder.files)
+			{
+				check(path);
+			}
+		}
+	}
+	return found;
+}
+
+bool LibraryFolderIndex::WalkLess(QString const& lhs, QString const& rhs, bool files) const
+{
+	QStringList const left{ lhs.mid(m_root.size() + 1).split('/') };
+	QStringList const right{ rhs.mid(m_root.size() + 1).split('/') };
+
+	qsizetype i{ 0 };
+	while (i < left.size() && i < right.size() && left[i] == right[i])
+	{
+		++i;
+	}
+
+	if (files)
+	{
+		//a file directly in the shared folder comes before anything in its sub folders
+		bool const leftHere{ i == left.size() - 1 };
+		bool const rightHere{ i == right.size() - 1 };
+		if (leftHere != rightHere)
+		{
+			return leftHere;
+		}
+	}
+	else
+	{
+		//pre-order, a folder comes before the folders inside it
+		if (i == left.size() || i == right.size())
+		{
+			return left.size() < right.size();
+		}
+	}
+	return CompareNames(left[i], right[i]) < 0;
+}
+
+QString LibraryFolderIndex::FindFile(QString const& startDir, QStringList const& fileNames) const
+{
+	QString const start{ Clean(startDir) };
+
+	//the walk order is the search order, so the earliest match wins across all the names
+	QString best;
+	for (auto const& fileName : fileNames)
+	{
+		for (auto const& path : Matches(fileName))
+		{
+			if (IsBelow(path, start) && (best.isEmpty() || WalkLess(path, best, true)))
+			{
+				best = path;
+			}
+		}
+	}
+	return best;
+}
+
+QStringList LibraryFolderIndex::FindFiles(QString const& startDir, QStringList const& fileNames) const
+{
+	QString const start{ Clean(startDir) };
+
+	QSet<QString> found;
+	for (auto const& fileName : fileNames)
+	{
+		for (auto const& path : Matches(fileName))
+		{
+			if (IsBelow(path, start))
+			{
+				found.insert(path);
+			}
+		}
+	}
+
+	QStringList files{ found.values() };
+	std::sort(files.begin(), files.end(), [this](QString const& lhs, QString const& rhs) { return WalkLess(lhs, rhs, true); });
+	return files;
+}
+
+QString LibraryFolderIndex::FindDirectory(QString const& startDir, QString const& dirName) const
+{
+	QString const start{ Clean(startDir) };
+
+	QString best;
+	for (auto const& path : m_dirNames.value(dirName))
+	{
+		if (IsBelow(path, start) && (best.isEmpty() || WalkLess(path, best, false)))
+		{
+			best = path;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,75 @@
+#ifndef LIBRARY_FOLDER_INDEX_H
+#define LIBRARY_FOLDER_INDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
+
+#include <atomic>
+#include <map>
+
+//Every file and folder below a library folder, walked once so a Fix run doesn't re-list the share per lookup
+//Results come back in the same depth-first order FindRecurseFile/FindRecurseDirectory walk the disk
+class LibraryFolderIndex
+{
+public:
+	//stop is checked before every folder, once it is set the walk ends and the index is incomplete
+	explicit LibraryFolderIndex(QString const& root, std::atomic<bool> const* stop = nullptr);
+
+	QString const& root() const { return m_root; }
+	bool Covers(QString const& dir) const;
+
+	//first file matching any of fileNames ("R.kicad_mod", "*.mod", "Device*.lib") below startDir
+	QString FindFile(QString const& startDir, QStringList const& fileNames) const;
+	//every file matching any of fileNames below startDir, in walk order
+	QStringList FindFiles(QString const& startDir, QStringList const& fileNames) const;
+	//first folder below startDir whose completeBaseName is dirName
+	QString FindDirectory(QString const& startDir, QString const& dirName) const;
+	//files directly inside dir, false if dir was not indexed
+	bool ListFiles(QString const& dir, QStringList& files) const;
+
+	//dir and every folder below it that is indexed
+	QStringList Directories(QString const& dir) const;
+	//lists dir again after a change: its files are replaced, sub folders that are new are walked and the ones gone are dropped
+	//unchanged sub folders are not touched, added/removed get every folder that came or went
+	void Relist(QString const& dir, QStringList& added, QStringList& removed);
+
+	//an index without a file system watcher is checked against the folder mtimes before it is used
+	bool watched() const { return m_watched; }
+	void SetWatched(bool watched) { m_watched = watched; }
+	//relists every folder whose mtime changed since it was read, returns the number of folders listed again
+	int Revalidate();
+	qsizetype folderCount() const { return static_cast<qsizetype>(m_folders.size()); }
+
+private:
+	struct Folder
+	{
+		QStringList files;
+		QStringList dirs;
+		QDateTime modified;
+	};
+
+	void Walk(QString const& dir);
+	//one folder from disk, nothing is indexed
+	static Folder Read(QString const& dir);
+	void AddFiles(Folder const& folder);
+	void DropFiles(Folder const& folder);
+	void Remove(QString const& dir);
+	QStringList Matches(QString const& fileName) const;
+	bool WalkLess(QString const& lhs, QString const& rhs, bool files) const;
+
+	static QString Clean(QString const& dir);
+	static bool IsBelow(QString const& path, QString const& startDir);
+
+	QString m_root;
+	std::map<QString, Folder> m_folders;
+	bool m_watched{ false };
+	std::atomic<bool> const* m_stop{ nullptr };	//only while the constructor walks
+	QHash<QString, QSet<QString>> m_fileNames;	//lower case file name -> paths
+	QHash<QString, QSet<QString>> m_suffixes;	//lower case last suffix -> paths
+	QHash<QString, QSet<QString>> m_dirNames;	//completeBaseName -> paths
+};
+
+#endif
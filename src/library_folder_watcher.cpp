@@ -0,0 +1,146 @@
+#include "library_folder_watcher.h"
+
+#include <QDir>
+
+constexpr int DEBOUNCE_MS = 500;
+//well below the default inotify limit of 8192 watches per user, other tools need some too
+constexpr qsizetype MAX_WATCHED_FOLDERS = 4096;
+
+LibraryFolderWatcher::LibraryFolderWatcher()
+{
+	m_debounce.setSingleShot(true);
+	m_debounce.setInterval(DEBOUNCE_MS);
+	connect(&m_debounce, &QTimer::timeout, this, &LibraryFolderWatcher::Refresh);
+	connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryFolderWatcher::DirectoryChanged);
+}
+
+LibraryFolderWatcher::~LibraryFolderWatcher()
+{
+	Abandon();
+}
+
+void LibraryFolderWatcher::Abandon()
+{
+	++m_generation;
+	if (m_builder.joinable())
+	{
+		//the walk checks m_stop per folder, so this only waits for the listing in progress
+		m_stop = true;
+		m_builder.join();
+		m_stop = false;
+	}
+}
+
+void LibraryFolderWatcher::Unwatch()
+{
+	if (auto const watched{ m_watcher.directories() }; !watched.isEmpty())
+	{
+		m_watcher.removePaths(watched);
+	}
+}
+
+void LibraryFolderWatcher::SetFolder(QString const& folder)
+{
+	Abandon();
+	m_debounce.stop();
+	m_changed.clear();
+	Unwatch();
+	m_index.reset();
+
+	if (folder.isEmpty() || !QDir(folder).exists())
+	{
+		return;
+	}
+
+	//walking a large or network share takes a while, the GUI keeps running and Find/Fix walk on their own until it is done
+	m_builder = std::thread([this, generation = m_generation, folder]()
+	{
+		auto index{ std::make_shared<LibraryFolderIndex>(folder, &m_stop) };
+		if (m_stop)
+		{
+			return;
+		}
+		//queued to the GUI thread, dropped by Qt if the watcher is gone before it runs
+		QMetaObject::invokeMethod(this, [this, generation, index = std::move(index)]()
+		{
+			if (generation == m_generation)
+			{
+				Publish(index);
+			}
+		}, Qt::QueuedConnection);
+	});
+}
+
+void LibraryFolderWatcher::Publish(std::shared_ptr<LibraryFolderIndex> index)
+{
+	if (m_builder.joinable())
+	{
+		m_builder.join();
+	}
+	m_index = std::move(index);
+
+	auto const dirs{ m_index->Directories(m_index->root()) };
+	bool watched{ dirs.size() <= MAX_WATCHED_FOLDERS };
+	if (watched)
+	{
+		if (auto const failed{ m_watcher.addPaths(dirs) }; !failed.isEmpty())
+		{
+			Unwatch();
+			watched = false;
+		}
+	}
+	m_index->SetWatched(watched);
+
+	if (watched)
+	{
+		emit SendMessage(QString("Indexed %1 folders in '%2'").arg(dirs.size()).arg(m_index->root()), spdlog::level::level_enum::debug, m_index->root());
+	}
+	else
+	{
+		emit SendMessage(QString("Indexed %1 folders in '%2', too many to watch, changes are found by folder mtime").arg(dirs.size()).arg(m_index->root()), spdlog::level::level_enum::info, m_index->root());
+	}
+	emit IndexReady(m_index);
+}
+
+void LibraryFolderWatcher::DirectoryChanged(QString const& path)
+{
+	m_changed.insert(QDir::cleanPath(path));
+	m_debounce.start();
+}
+
+void LibraryFolderWatcher::Refresh()
+{
+	if (!m_index || !m_index->watched())
+	{
+		m_changed.clear();
+		return;
+	}
+
+	//only the changed folders are listed again, a new sub folder is walked, siblings stay as they are
+	QStringList changed{ m_changed.values() };
+	m_changed.clear();
+	changed.sort();
+
+	for (auto const& path : changed)
+	{
+		QStringList added;
+		QStringList removed;
+		m_index->Relist(path, added, removed);
+		if (!removed.isEmpty())
+		{
+			m_watcher.removePaths(removed);
+		}
+		if (!added.isEmpty())
+		{
+			if (m_watcher.directories().size() + added.size() > MAX_WATCHED_FOLDERS || !m_watcher.addPaths(added).isEmpty())
+			{
+				//the share outgrew the watches, from now on the index is checked by mtime when it is used
+				Unwatch();
+				m_index->SetWatched(false);
+				emit SendMessage(QString("Too many folders to watch in '%1', changes are found by folder mtime").arg(m_index->root()), spdlog::level::level_enum::info, m_index->root());
+				return;
+			}
+		}
+		emit SendMessage(QString("Library folder changed '%1'").arg(path), spdlog::level::level_enum::debug, path);
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef LIBRARY_FOLDER_WATCHER_H
+#define LIBRARY_FOLDER_WATCHER_H
+
+#include "library_folder_index.h"
+
+#include "spdlog/spdlog.h"
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QSet>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+//Keeps a LibraryFolderIndex of the library folder current for the whole session
+//the index is built on a background thread and published with IndexReady, until then index() is empty
+//directory change events are collected for a short while, then only the changed folders are listed again
+//shares with more folders than can be watched get an unwatched index that is checked by mtime on use
+class LibraryFolderWatcher : public QObject
+{
+Q_OBJECT
+
+public:
+	LibraryFolderWatcher();
+	~LibraryFolderWatcher();
+
+	void SetFolder(QString const& folder);
+	std::shared_ptr<LibraryFolderIndex> index() const { return m_index; }
+
+Q_SIGNALS:
+	void SendMessage(QString const& message, spdlog::level::level_enum llvl, QString const& file) const;
+	void IndexReady(std::shared_ptr<LibraryFolderIndex> index) const;
+
+private:
+	void Publish(std::shared_ptr<LibraryFolderIndex> index);
+	//stops the running build and waits for it, a result it already queued is dropped
+	void Abandon();
+	void Unwatch();
+	void DirectoryChanged(QString const& path);
+	void Refresh();
+
+	std::shared_ptr<LibraryFolderIndex> m_index;
+	std::thread m_builder;
+	std::atomic<bool> m_stop{ false };
+	quint64 m_generation{ 0 };	//bumped by Abandon, a queued result of an older build is ignored
+	QFileSystemWatcher m_watcher;
+	QTimer m_debounce;
+	QSet<QString> m_changed;
+};
+
+#endif
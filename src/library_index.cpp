@@ -0,0 +1,75 @@
+#include "library_index.h"
+
+#include <algorithm>
+
+constexpr std::size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+void LibraryIndex::Clear()
+{
+	m_items.clear();
+	m_libraries.clear();
+	m_blocks.clear();
+	m_blockUsed = 0;
+	m_blockSize = 0;
+	m_arenaSize = 0;
+}
+
+bool LibraryIndex::HasLibrary(QString const& library) const
+{
+	return m_libraries.find(QStringView(library)) != m_libraries.end();
+}
+
+void LibraryIndex::AddLibrary(QString const& library, QStringList const& names)
+{
+	QStringView const libName{ Intern(library, QStringView()) };
+	//drop the trailing ':' so the library entry is just the name
+	m_libraries.insert(libName.left(libName.size() - 1));
+
+	m_items.reserve(m_items.size() + static_cast<std::size_t>(names.size()));
+	for (auto const& name : names)
+	{
+		m_items.insert(Intern(library, name));
+	}
+}
+
+bool LibraryIndex::Contains(QStringView libId) const
+{
+	auto const colon{ libId.indexOf(QChar(':')) };
+	if (colon < 0)
+	{
+		return false;
+	}
+
+	//same split as "Lib:Item:extra".split(":") used to give, only the first two parts count
+	auto const extra{ libId.indexOf(QChar(':'), colon + 1) };
+	QStringView const key{ extra < 0 ? libId : libId.left(extra) };
+	return m_items.find(key) != m_items.end();
+}
+
+std::size_t LibraryIndex::memoryUsage() const
+{
+	//node = value + next pointer + cached hash, as in libstdc++/MSVC
+	constexpr std::size_t nodeSize{ sizeof(QStringView) + sizeof(void*) + sizeof(std::size_t) };
+	return m_arenaSize * sizeof(QChar) +
+		(m_items.bucket_count() + m_libraries.bucket_count()) * sizeof(void*) +
+		(m_items.size() + m_libraries.size()) * nodeSize;
+}
+
+QStringView LibraryIndex::Intern(QStringView library, QStringView name)
+{
+	std::size_t const length{ static_cast<std::size_t>(library.size() + 1 + name.size()) };
+	if (m_blocks.empty() || m_blockUsed + length > m_blockSize)
+	{
+		m_blockSize = std::max(ARENA_BLOCK_SIZE, length);
+		m_blocks.push_back(std::make_unique<QChar[]>(m_blockSize));
+		m_blockUsed = 0;
+		m_arenaSize += m_blockSize;
+	}
+
+	QChar* const start{ m_blocks.back().get() + m_blockUsed };
+	std::copy(library.begin(), library.end(), start);
+	start[library.size()] = QChar(':');
+	std::copy(name.begin(), name.end(), start + library.size() + 1);
+	m_blockUsed += length;
+	return QStringView(start, static_cast<qsizetype>(length));
+}
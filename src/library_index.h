@@ -0,0 +1,47 @@
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QHash>
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+//"library:item" lookup table, names are interned into an arena so a lookup is one hash probe on a view
+class LibraryIndex
+{
+public:
+	void Clear();
+
+	bool HasLibrary(QString const& library) const;
+	void AddLibrary(QString const& library, QStringList const& names);
+
+	//libId as written in a schematic, "Device:R" or "Resistor_SMD:R_0603_1608Metric"
+	bool Contains(QStringView libId) const;
+
+	std::size_t libraryCount() const { return m_libraries.size(); }
+	std::size_t itemCount() const { return m_items.size(); }
+	//approximate heap use of the arena and both hash tables, in bytes
+	std::size_t memoryUsage() const;
+
+private:
+	struct ViewHash
+	{
+		std::size_t operator()(QStringView view) const { return static_cast<std::size_t>(qHash(view)); }
+	};
+
+	QStringView Intern(QStringView library, QStringView name);
+
+	std::vector<std::unique_ptr<QChar[]>> m_blocks;
+	std::size_t m_blockUsed{ 0 };
+	std::size_t m_blockSize{ 0 };
+	std::size_t m_arenaSize{ 0 };
+
+	std::unordered_set<QStringView, ViewHash> m_libraries;
+	std::unordered_set<QStringView, ViewHash> m_items;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "library_index_cache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include <algorithm>
+
+constexpr int INDEX_VERSION = 1;
+
+LibraryIndexCache::LibraryIndexCache(QString fileName) :
+	m_fileName(std::move(fileName))
+{
+	Load();
+}
+
+bool LibraryIndexCache::Find(QString const& path, QStringList& names) const
+{
+	auto const found{ m_libraries.find(path) };
+	if (found == m_libraries.end())
+	{
+		return false;
+	}
+
+	//a .pretty folder's mtime changes whenever a footprint is added, removed or renamed
+	QFileInfo const fileData(path);
+	if (!fileData.exists() ||
+		found->second.size != fileData.size() ||
+		found->second.modified != fileData.lastModified().toMSecsSinceEpoch())
+	{
+		return false;
+	}
+	names = found->second.names;
+	found->second.used = true;
+	return true;
+}
+
+void LibraryIndexCache::Store(QString const& path, QStringList const& names)
+{
+	QFileInfo const fileData(path);
+	if (!fileData.exists())
+	{
+		return;
+	}
+	m_libraries[path] = { fileData.size(), fileData.lastModified().toMSecsSinceEpoch(), names, true };
+	m_dirty = true;
+}
+
+void LibraryIndexCache::Prune()
+{
+	//the footprint and symbol finders share the index, so this only runs once the session is over
+	//a session that loaded no libraries at all keeps the whole index
+	if (std::none_of(m_libraries.begin(), m_libraries.end(), [](auto const& library) { return library.second.used; }))
+	{
+		return;
+	}
+	auto const removed{ std::erase_if(m_libraries, [](auto const& library) { return !library.second.used; }) };
+	m_dirty = m_dirty || removed > 0;
+}
+
+void LibraryIndexCache::Clear()
+{
+	m_libraries.clear();
+	m_dirty = true;
+}
+
+void LibraryIndexCache::Load()
+{
+	if (m_fileName.isEmpty())
+	{
+		return;
+	}
+
+	QFile loadFile(m_fileName);
+	if (!loadFile.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QJsonObject const json{ QJsonDocument::fromJson(loadFile.readAll()).object() };
+	if (json["version"].toInt() != INDEX_VERSION)
+	{
+		return;
+	}
+
+	for (auto const& value : json["libraries"].toArray())
+	{
+		QJsonObject const libObj{ value.toObject() };
+		QString const path{ libObj["path"].toString() };
+		if (path.isEmpty())
+		{
+			continue;
+		}
+		Entry entry;
+		entry.size = libObj["size"].toVariant().toLongLong();
+		entry.modified = libObj["modified"].toVariant().toLongLong();
+		for (auto const& name : libObj["names"].toArray())
+		{
+			entry.names.append(name.toString());
+		}
+		m_libraries.emplace(path, std::move(entry));
+	}
+}
+
+void LibraryIndexCache::Save()
+{
+	if (!m_dirty || m_fileName.isEmpty())
+	{
+		return;
+	}
+
+	QFile saveFile(m_fileName);
+	if (!saveFile.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	std::erase_if(m_libraries, [](auto const& library) { return !QFileInfo::exists(library.first); });
+
+	QJsonArray libArray;
+	for (auto const& [path, entry] : m_libraries)
+	{
+		QJsonObject libObj;
+		libObj["path"] = path;
+		libObj["size"] = entry.size;
+		libObj["modified"] = entry.modified;
+		libObj["names"] = QJsonArray::fromStringList(entry.names);
+		libArray.append(libObj);
+	}
+
+	QJsonObject json;
+	json["version"] = INDEX_VERSION;
+	json["libraries"] = libArray;
+	saveFile.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+	m_dirty = false;
+}
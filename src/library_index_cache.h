@@ -0,0 +1,42 @@
+#ifndef LIBRARY_INDEX_CACHE_H
+#define LIBRARY_INDEX_CACHE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <map>
+
+//Footprint/symbol names per library, kept on disk and reused while the library's mtime and size match
+class LibraryIndexCache
+{
+public:
+	LibraryIndexCache() = default;
+	explicit LibraryIndexCache(QString fileName);
+
+	//path is the resolved library file or .pretty folder, false if it changed or was never indexed
+	bool Find(QString const& path, QStringList& names) const;
+	void Store(QString const& path, QStringList const& names);
+
+	//writes the index file if anything was stored since the last save, libraries that are gone are left out
+	void Save();
+	//drops every library neither found nor stored since the index was loaded, unless none was, the next Save writes the rest
+	void Prune();
+	void Clear();
+
+private:
+	struct Entry
+	{
+		qint64 size{ 0 };
+		qint64 modified{ 0 };
+		QStringList names;
+		mutable bool used{ false };	//found or stored in this session
+	};
+
+	void Load();
+
+	QString m_fileName;
+	std::map<QString, Entry> m_libraries;
+	bool m_dirty{ false };
+};
+
+#endif
@@ -25,4 +25,32 @@ struct LibraryInfo
 	QString url;
 	QString options;
 	QString descr;
-};
\ No newline at end of file
+};
+
+//One pending edit of the project library table, planned by a Fix run before anything is written
+struct LibraryTableChange
+{
+	enum class Kind { Relink, Relative, Add, Update };
+
+	Kind kind{ Kind::Add };
+	QString name;
+	QString type;
+	QString oldUrl;
+	QString newUrl;
+
+	QString asString() const
+	{
+		switch (kind)
+		{
+		case Kind::Relink:
+			return QString("Relink '%1' from '%2' to '%3'").arg(name).arg(oldUrl).arg(newUrl);
+		case Kind::Relative:
+			return QString("Make '%1' relative '%2'").arg(name).arg(newUrl);
+		case Kind::Update:
+			return QString("Update '%1' from '%2' to '%3'").arg(name).arg(oldUrl).arg(newUrl);
+		case Kind::Add:
+		default:
+			return QString("Add '%1' (%2) '%3'").arg(name).arg(type).arg(newUrl);
+		}
+	}
+};
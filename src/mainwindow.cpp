@@ -7,6 +7,7 @@
 #include "threed_model_finder.h" 
 #include "schematic_adder.h"
 #include "text_replace.h"
+#include "library_folder_watcher.h"
 
 #include "addpartnumber.h"
 #include "addmapping.h"
@@ -15,6 +16,7 @@
 #include "mapping.h"
 
 #include "kicad_utils.h"
+#include "benchmark.h"
 
 #include "config.h"
 
@@ -78,7 +80,14 @@ MainWindow::MainWindow(QWidget *parent)
 
 	settings = std::make_unique< QSettings>(appdir + "/settings.ini", QSettings::IniFormat);
 
+	//one parse per sheet, no matter how many tabs look at it
+	auto const documents{ std::make_shared<SchematicDocumentCache>() };
+	//library name lists survive restarts, only libraries changed on disk get re-read
+	library_index = std::make_shared<LibraryIndexCache>(appdir + "/library_index.json");
+
 	footprint_finder = std::make_unique<FootprintFinder>();
+	footprint_finder->SetDocumentCache(documents);
+	footprint_finder->SetIndexCache(library_index);
 	connect(footprint_finder.get(), &LibraryBase::SendMessage, this, &MainWindow::LogMessage );
 	connect(footprint_finder.get(), &LibraryBase::SendAddLibrary, this, &MainWindow::AddFootprintLibrary );
 	connect(footprint_finder.get(), &LibraryBase::SendClearLibrary, this, &MainWindow::ClearFootprintLibrary );
@@ -88,6 +97,8 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(footprint_finder.get(), &LibraryBase::SendLibraryError, this, &MainWindow::SetSymbolLibraryError);
 
 	symbol_finder = std::make_unique<SymbolFinder>();
+	symbol_finder->SetDocumentCache(documents);
+	symbol_finder->SetIndexCache(library_index);
 	connect(symbol_finder.get(), &LibraryBase::SendMessage, this, &MainWindow::LogMessage );
 	connect(symbol_finder.get(), &LibraryBase::SendAddLibrary, this, &MainWindow::AddSymbolLibrary );
 	connect(symbol_finder.get(), &LibraryBase::SendClearLibrary, this, &MainWindow::ClearSymbolLibrary );
@@ -97,11 +108,13 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(symbol_finder.get(), &LibraryBase::SendLibraryError, this, &MainWindow::SetSymbolLibraryError);
 
 	threed_model_finder = std::make_unique<ThreeDModelFinder>();
+	threed_model_finder->SetDocumentCache(documents);
 	connect(threed_model_finder.get(), &LibraryBase::SendMessage, this, &MainWindow::LogMessage);
 	connect(threed_model_finder.get(), &LibraryBase::SendResult, this, &MainWindow::AddThreeDModelMsg);
 	connect(threed_model_finder.get(), &LibraryBase::SendClearResults, this, &MainWindow::ClearThreeDModelMsgs);
 
 	schematic_adder = std::make_unique<SchematicAdder>();
+	schematic_adder->SetDocumentCache(documents);
 	connect(schematic_adder.get(), &SchematicAdder::SendMessage, this, &MainWindow::LogMessage );
 	connect(schematic_adder.get(), &SchematicAdder::RedrawPartList, this, &MainWindow::RedrawPartList);
 	connect(schematic_adder.get(), &SchematicAdder::UpdatePartRow, this, &MainWindow::UpdatePartRow);
@@ -111,6 +124,15 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(text_replace.get(), &TextReplace::RedrawTextReplace, this, &MainWindow::RedrawMappingList);
 	connect(text_replace.get(), &TextReplace::UpdateTextRow, this, &MainWindow::UpdateMappingRow);
 
+	library_watcher = std::make_unique<LibraryFolderWatcher>();
+	connect(library_watcher.get(), &LibraryFolderWatcher::SendMessage, this, &MainWindow::LogMessage);
+	connect(library_watcher.get(), &LibraryFolderWatcher::IndexReady, this, [this](std::shared_ptr<LibraryFolderIndex> index)
+	{
+		footprint_finder->SetFolderIndex(index);
+		symbol_finder->SetFolderIndex(index);
+		threed_model_finder->SetFolderIndex(index);
+	});
+
 	bool overrideImport = settings->value("override", false).toBool();
 
 	ui->actionOverride->setChecked(overrideImport);
@@ -128,6 +150,12 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    //libraries that weren't looked at in this session are left out of the index file
+    if (library_index)
+    {
+        library_index->Prune();
+        library_index->Save();
+    }
     delete ui;
 }
 
@@ -155,6 +183,14 @@ void MainWindow::on_actionSet_Library_Folder_triggered()
 	}
 }
 
+void MainWindow::on_actionFind_Duplicates_triggered()
+{
+	ClearFootprintMsgs();
+	footprint_finder->FindDuplicateFootprints();
+	ClearSymbolMsgs();
+	symbol_finder->FindDuplicateSymbols();
+}
+
 void MainWindow::on_actionImport_Rename_Map_triggered()
 {
 	QString const rename = QFileDialog::getOpenFileName(this, "Select Rename File", settings->value("last_rename").toString(), tr("CSV Files (*.csv);;JSON Files (*.json);;All Files (*.*)"));
@@ -472,6 +508,12 @@ void MainWindow::on_pbFixFP_clicked()
 		LogMessage("Directory Doesn't Exist", spdlog::level::level_enum::warn);
 		return;
 	}
+	if (ui->actionPreview_Fixes->isChecked())
+	{
+		ClearFootprintMsgs();
+		footprint_finder->PreviewFootprintFix(ui->leLibraryFolder->text());
+		return;
+	}
 	footprint_finder->FixFootprints(ui->leLibraryFolder->text());
 }
 
@@ -501,6 +543,12 @@ void MainWindow::on_pbFixSym_clicked()
 		LogMessage("Directory Doesn't Exist", spdlog::level::level_enum::warn);
 		return;
 	}
+	if (ui->actionPreview_Fixes->isChecked())
+	{
+		ClearSymbolMsgs();
+		symbol_finder->PreviewSymbolFix(ui->leLibraryFolder->text());
+		return;
+	}
 	symbol_finder->FixSymbols(ui->leLibraryFolder->text());
 }
 
@@ -643,6 +691,18 @@ void MainWindow::on_pbCheck3DModels_clicked()
 	threed_model_finder->CheckPCBs();
 }
 
+void MainWindow::on_pbCompareSchPCB_clicked()
+{
+	ClearThreeDModelMsgs();
+	threed_model_finder->CompareSchematics();
+}
+
+void MainWindow::on_pbAuditModels_clicked()
+{
+	ClearThreeDModelMsgs();
+	threed_model_finder->AuditModelWeights(ui->leLibraryFolder->text());
+}
+
 void MainWindow::on_pbFix3DModels_clicked() 
 {
 	QDir directory(ui->leLibraryFolder->text());
@@ -955,6 +1015,13 @@ void MainWindow::SetLibrary(QString const& library)
 	ui->leLibraryFolder->setText(library);
 	settings->setValue("last_library", library);
 	settings->sync();
+
+	//keep the folder indexed and watched so Find/Fix don't walk the share again
+	//the index is built in the background, IndexReady hands it to the finders
+	library_watcher->SetFolder(library);
+	footprint_finder->SetFolderIndex(library_watcher->index());
+	symbol_finder->SetFolderIndex(library_watcher->index());
+	threed_model_finder->SetFolderIndex(library_watcher->index());
 }
 
 void MainWindow::RedrawPartList(bool save)
@@ -1501,6 +1568,10 @@ void MainWindow::ProcessCommandLine()
 		"Attempt to Find Symbols and Footprints.");
 	parser.addOption(fixOption);
 
+	QCommandLineOption dryRunOption(QStringList() << "dry-run",
+		"Only Report the Library Table Changes Find Would Make.");
+	parser.addOption(dryRunOption);
+
 	QCommandLineOption checkSymOption(QStringList() << "s" << "checksym",
             "Check Schematic Symbols.");
     parser.addOption(checkSymOption);
@@ -1513,6 +1584,14 @@ void MainWindow::ProcessCommandLine()
             "Check 3D Model Paths.");
     parser.addOption(check3dOption);
 
+	QCommandLineOption compareOption(QStringList() << "compare",
+		"Compare Schematic and PCB Footprints.");
+	parser.addOption(compareOption);
+
+	QCommandLineOption weightsOption(QStringList() << "model-weights",
+		"Report the Heaviest 3D Models of each PCB.");
+	parser.addOption(weightsOption);
+
 	QCommandLineOption fixSymOption(QStringList() << "y" << "findsym",
 		"Attempt to Find Schematic Symbols.");
 	parser.addOption(fixSymOption);
@@ -1531,6 +1610,20 @@ void MainWindow::ProcessCommandLine()
 
     parser.addOption(replaceOption);
 
+	QCommandLineOption duplicatesOption(QStringList() << "duplicates",
+		"Find Footprints and Symbols that only differ by Name.");
+	parser.addOption(duplicatesOption);
+
+	QCommandLineOption benchmarkOption(QStringList() << "benchmark",
+		"Time the Marker Scan of a Kicad File and the Name Matcher on 100k Names.",
+		"benchmark");
+	parser.addOption(benchmarkOption);
+
+	QCommandLineOption benchmarkWalkOption(QStringList() << "benchmark-walk",
+		"Time the Directory Walker on a Synthetic Tree of N Files.",
+		"files");
+	parser.addOption(benchmarkWalkOption);
+
 	QCommandLineOption exitOption(QStringList() << "x" << "exit",
             "Exit Software when done.");
     parser.addOption(exitOption);
@@ -1588,6 +1681,11 @@ void MainWindow::ProcessCommandLine()
 		on_pbAddPN_clicked();
 	}
 
+	if (parser.isSet(dryRunOption))
+	{
+		ui->actionPreview_Fixes->setChecked(true);
+	}
+
 	if(parser.isSet(checkOption) || parser.isSet(checkFpOption))
 	{
 		on_pbCheckFP_clicked();
@@ -1618,6 +1716,21 @@ void MainWindow::ProcessCommandLine()
 		on_pbFix3DModels_clicked();
 	}
 
+	if (parser.isSet(compareOption))
+	{
+		on_pbCompareSchPCB_clicked();
+	}
+
+	if (parser.isSet(weightsOption))
+	{
+		on_pbAuditModels_clicked();
+	}
+
+	if (parser.isSet(duplicatesOption))
+	{
+		on_actionFind_Duplicates_triggered();
+	}
+
 	if (!parser.value(bomOption).isEmpty())
 	{
 		schematic_adder->GenerateBOM(parser.value(bomOption),ui->leProjectFolder->text());
@@ -1628,6 +1741,17 @@ void MainWindow::ProcessCommandLine()
 		SaveFootPrintReport(parser.value(reportOption));
 	}
 
+	if (!parser.value(benchmarkOption).isEmpty())
+	{
+		LogMessage(benchmark::MarkerScan(parser.value(benchmarkOption)), spdlog::level::level_enum::info);
+		LogMessage(benchmark::NameMatch(), spdlog::level::level_enum::info);
+	}
+
+	if (!parser.value(benchmarkWalkOption).isEmpty())
+	{
+		LogMessage(benchmark::DirectoryWalk(parser.value(benchmarkWalkOption).toInt()), spdlog::level::level_enum::info);
+	}
+
 	if(parser.isSet(exitOption))
 	{
 		close();
@@ -25,6 +25,8 @@ class SymbolFinder;
 class ThreeDModelFinder;
 class SchematicAdder;
 class TextReplace;
+class LibraryFolderWatcher;
+class LibraryIndexCache;
 struct Mapping;
 
 class MainWindow : public QMainWindow
@@ -40,6 +42,7 @@ public Q_SLOTS:
     void on_actionOpen_Project_triggered();
     void on_actionReload_Project_triggered();
     void on_actionSet_Library_Folder_triggered();
+    void on_actionFind_Duplicates_triggered();
 
     void on_actionImport_Rename_Map_triggered();
     void on_actionImport_PartList_triggered();
@@ -93,6 +96,8 @@ public Q_SLOTS:
     //4nd tab
     void on_pbCheck3DModels_clicked();
     void on_pbFix3DModels_clicked();
+    void on_pbCompareSchPCB_clicked();
+    void on_pbAuditModels_clicked();
 
     //5th tab
     void on_pbTextReplace_clicked();
@@ -158,6 +163,8 @@ private:
     std::unique_ptr<ThreeDModelFinder> threed_model_finder{ nullptr };
     std::unique_ptr<SchematicAdder> schematic_adder{ nullptr };
     std::unique_ptr<TextReplace> text_replace{ nullptr };
+    std::unique_ptr<LibraryFolderWatcher> library_watcher{ nullptr };
+    std::shared_ptr<LibraryIndexCache> library_index{ nullptr };
 
     QString appdir;
     QString helpText;
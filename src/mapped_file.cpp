@@ -0,0 +1,37 @@
+#include "mapped_file.h"
+
+MappedFile::MappedFile(QString const& path) :
+	m_file(path)
+{
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+	m_open = true;
+
+	qint64 const fileSize{ m_file.size() };
+	if (fileSize <= 0)
+	{
+		return;
+	}
+
+	m_map = m_file.map(0, fileSize);
+	if (m_map != nullptr)
+	{
+		m_data = std::string_view(reinterpret_cast<char const*>(m_map), static_cast<std::size_t>(fileSize));
+		return;
+	}
+
+	//some network shares don't support mapping
+	m_buffer = m_file.readAll();
+	m_data = std::string_view(m_buffer.constData(), static_cast<std::size_t>(m_buffer.size()));
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_map != nullptr)
+	{
+		m_file.unmap(m_map);
+	}
+	m_file.close();
+}
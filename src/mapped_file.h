@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <QFile>
+#include <QByteArray>
+
+#include <string_view>
+
+//Read-only memory map of a KiCad file, falls back to reading the file when it can't be mapped
+class MappedFile
+{
+public:
+	explicit MappedFile(QString const& path);
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	bool isOpen() const { return m_open; }
+	std::string_view data() const { return m_data; }
+	std::size_t size() const { return m_data.size(); }
+
+private:
+	QFile m_file;
+	uchar* m_map{ nullptr };
+	QByteArray m_buffer;
+	std::string_view m_data;
+	bool m_open{ false };
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include "marker_scanner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MARKER_SCANNER_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define MARKER_SCANNER_AVX2_TARGET
+	#else
+		#define MARKER_SCANNER_AVX2_TARGET __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace
+{
+	bool IsDelimiter(char c)
+	{
+		return c == '(' || c == ')' || c == '"' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+#if defined(MARKER_SCANNER_X86)
+	bool CpuHasAVX2()
+	{
+	#if defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 1);
+		bool const osxsave{ (info[2] & (1 << 27)) != 0 };
+		if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+#endif
+}
+
+MarkerScanner::MarkerScanner(std::initializer_list<std::string_view> keywords) :
+	m_keywords(keywords)
+{
+	for (auto const& keyword : m_keywords)
+	{
+		if (keyword.empty())
+		{
+			continue;
+		}
+		auto const first{ static_cast<unsigned char>(keyword.front()) };
+		if (!m_firstCharMap[first])
+		{
+			m_firstCharMap[first] = true;
+			m_firstChars.push_back(keyword.front());
+		}
+	}
+}
+
+MarkerScanner::Kernel MarkerScanner::BestKernel()
+{
+#if defined(MARKER_SCANNER_X86)
+	static Kernel const kernel{ CpuHasAVX2() ? Kernel::AVX2 : Kernel::SSE2 };
+	return kernel;
+#else
+	return Kernel::Scalar;
+#endif
+}
+
+char const* MarkerScanner::KernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::AVX2: return "AVX2";
+	case Kernel::SSE2: return "SSE2";
+	default: return "Scalar";
+	}
+}
+
+std::vector<std::size_t> MarkerScanner::Scan(std::string_view data) const
+{
+	return Scan(data, BestKernel());
+}
+
+std::vector<std::size_t> MarkerScanner::Scan(std::string_view data, Kernel kernel) const
+{
+	std::vector<std::size_t> offsets;
+	std::size_t done{ 0 };
+#if defined(MARKER_SCANNER_X86)
+	if (kernel == Kernel::AVX2)
+	{
+		done = ScanAVX2(data, offsets);
+	}
+	else if (kernel == Kernel::SSE2)
+	{
+		done = ScanSSE2(data, offsets);
+	}
+#endif
+	ScanScalar(data, done, offsets);
+	return offsets;
+}
+
+bool MarkerScanner::Matches(std::string_view data, std::size_t pos) const
+{
+	auto const rest{ data.substr(pos + 1) };
+	return std::any_of(m_keywords.begin(), m_keywords.end(), [&](auto const& keyword)
+		{
+			return rest.size() > keyword.size() && rest.compare(0, keyword.size(), keyword) == 0 && IsDelimiter(rest[keyword.size()]);
+		});
+}
+
+void MarkerScanner::ScanScalar(std::string_view data, std::size_t from, std::vector<std::size_t>& offsets) const
+{
+	for (std::size_t i = from; i + 1 < data.size(); ++i)
+	{
+		if (data[i] == '(' && m_firstCharMap[static_cast<unsigned char>(data[i + 1])] && Matches(data, i))
+		{
+			offsets.push_back(i);
+		}
+	}
+}
+
+#if defined(MARKER_SCANNER_X86)
+
+//each kernel compares a block against '(' and the block shifted by one against the keyword first letters,
+//only the surviving bits are verified with a full keyword compare
+std::size_t MarkerScanner::ScanSSE2(std::string_view data, std::vector<std::size_t>& offsets) const
+{
+	char const* const base{ data.data() };
+	std::size_t const size{ data.size() };
+	__m128i const open{ _mm_set1_epi8('(') };
+
+	std::size_t i{ 0 };
+	for (; i + 17 <= size; i += 16)
+	{
+		__m128i const block{ _mm_loadu_si128(reinterpret_cast<__m128i const*>(base + i)) };
+		unsigned mask{ static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, open))) };
+		if (mask == 0)
+		{
+			continue;
+		}
+		__m128i const next{ _mm_loadu_si128(reinterpret_cast<__m128i const*>(base + i + 1)) };
+		__m128i first{ _mm_setzero_si128() };
+		for (char const c : m_firstChars)
+		{
+			first = _mm_or_si128(first, _mm_cmpeq_epi8(next, _mm_set1_epi8(c)));
+		}
+		mask &= static_cast<unsigned>(_mm_movemask_epi8(first));
+		while (mask != 0)
+		{
+			std::size_t const pos{ i + static_cast<std::size_t>(std::countr_zero(mask)) };
+			if (Matches(data, pos))
+			{
+				offsets.push_back(pos);
+			}
+			mask &= mask - 1;
+		}
+	}
+	return i;
+}
+
+MARKER_SCANNER_AVX2_TARGET
+std::size_t MarkerScanner::ScanAVX2(std::string_view data, std::vector<std::size_t>& offsets) const
+{
+	char const* const base{ data.data() };
+	std::size_t const size{ data.size() };
+	__m256i const open{ _mm256_set1_epi8('(') };
+
+	std::size_t i{ 0 };
+	for (; i + 33 <= size; i += 32)
+	{
+		__m256i const block{ _mm256_loadu_si256(reinterpret_cast<__m256i const*>(base + i)) };
+		auto mask{ static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, open))) };
+		if (mask == 0)
+		{
+			continue;
+		}
+		__m256i const next{ _mm256_loadu_si256(reinterpret_cast<__m256i const*>(base + i + 1)) };
+		__m256i first{ _mm256_setzero_si256() };
+		for (char const c : m_firstChars)
+		{
+			first = _mm256_or_si256(first, _mm256_cmpeq_epi8(next, _mm256_set1_epi8(c)));
+		}
+		mask &= static_cast<std::uint32_t>(_mm256_movemask_epi8(first));
+		while (mask != 0)
+		{
+			std::size_t const pos{ i + static_cast<std::size_t>(std::countr_zero(mask)) };
+			if (Matches(data, pos))
+			{
+				offsets.push_back(pos);
+			}
+			mask &= mask - 1;
+		}
+	}
+	return i;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MARKER_SCANNER_H
+#define MARKER_SCANNER_H
+
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+//Finds every "(keyword" marker in a buffer in one vectorized pass, so the
+//finders only hand those offsets to the tokenizer instead of every byte
+class MarkerScanner
+{
+public:
+	enum class Kernel { Scalar, SSE2, AVX2 };
+
+	explicit MarkerScanner(std::initializer_list<std::string_view> keywords);
+
+	//offsets of the '(' of each marker, in file order
+	std::vector<std::size_t> Scan(std::string_view data) const;
+	std::vector<std::size_t> Scan(std::string_view data, Kernel kernel) const;
+
+	//best kernel supported by the running CPU
+	static Kernel BestKernel();
+	static char const* KernelName(Kernel kernel);
+
+private:
+	bool Matches(std::string_view data, std::size_t pos) const;
+
+	void ScanScalar(std::string_view data, std::size_t from, std::vector<std::size_t>& offsets) const;
+	std::size_t ScanSSE2(std::string_view data, std::vector<std::size_t>& offsets) const;
+	std::size_t ScanAVX2(std::string_view data, std::vector<std::size_t>& offsets) const;
+
+	std::vector<std::string_view> m_keywords;
+	std::vector<char> m_firstChars;
+	bool m_firstCharMap[256]{};
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "model_index.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+void ModelIndex::Clear()
+{
+	m_models.clear();
+	m_count = 0;
+	m_roots.clear();
+	m_folders.clear();
+}
+
+void ModelIndex::AddRoot(QString const& root, QStringList const& files, QStringList const& folders)
+{
+	QString const top{ QDir::cleanPath(root) };
+	m_roots.append(top);
+	m_folders.insert(top, QFileInfo(top).lastModified());
+	//a model dropped into a folder that held none so far changes only that folder's mtime
+	for (auto const& folder : folders)
+	{
+		m_folders.insert(QDir::cleanPath(folder), QFileInfo(folder).lastModified());
+	}
+	AddFiles(files);
+}
+
+bool ModelIndex::Current(QStringList const& roots) const
+{
+	if (m_roots.isEmpty() || m_roots.size() != roots.size())
+	{
+		return false;
+	}
+	for (qsizetype i = 0; i < roots.size(); ++i)
+	{
+		if (m_roots[i] != QDir::cleanPath(roots[i]))
+		{
+			return false;
+		}
+	}
+	for (auto it{ m_folders.constBegin() }; it != m_folders.constEnd(); ++it)
+	{
+		if (QFileInfo(it.key()).lastModified() != it.value())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+QStringList const& ModelIndex::NameFilters()
+{
+	static QStringList const filters{ "*.wrl", "*.wrz", "*.step", "*.stp" };
+	return filters;
+}
+
+void ModelIndex::AddFiles(QStringList const& files)
+{
+	for (auto const& file : files)
+	{
+		auto& paths{ m_models[QFileInfo(file).completeBaseName().toLower()] };
+		if (!paths.contains(file))
+		{
+			paths.append(file);
+			++m_count;
+		}
+	}
+}
+
+QString ModelIndex::Find(QString const& model) const
+{
+	QFileInfo const wanted(model);
+	auto const found{ m_models.constFind(wanted.completeBaseName().toLower()) };
+	if (found == m_models.constEnd())
+	{
+		return QString();
+	}
+
+	QString const folder{ wanted.dir().dirName() };
+	QString const suffix{ wanted.suffix() };
+
+	//files were added in walk order, so ties keep the first one found
+	QString best;
+	int bestScore{ -1 };
+	for (auto const& path : found.value())
+	{
+		QFileInfo const file(path);
+		int const score{ (file.dir().dirName().compare(folder, Qt::CaseInsensitive) == 0 ? 2 : 0) + (file.suffix().compare(suffix, Qt::CaseInsensitive) == 0 ? 1 : 0) };
+		if (score > bestScore)
+		{
+			best = path;
+			bestScore = score;
+		}
+	}
+	return best;
+}
+
+QStringList ModelIndex::Matches(QString const& model) const
+{
+	return m_models.value(QFileInfo(model).completeBaseName().toLower());
+}
@@ -0,0 +1,36 @@
+#ifndef MODEL_INDEX_H
+#define MODEL_INDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QDateTime>
+
+//3D model files (.wrl/.wrz/.step/.stp) by lower case base name, so a model that moved is found with one lookup
+class ModelIndex
+{
+public:
+	void Clear();
+	void AddFiles(QStringList const& files);
+	//files found below root, root and every folder walked below it are remembered with their mtime
+	void AddRoot(QString const& root, QStringList const& files, QStringList const& folders);
+	//true when the index was built from roots and none of their folders changed since
+	bool Current(QStringList const& roots) const;
+
+	//best file with the base name of model: same folder name ("Resistor_SMD.3dshapes") first, then the same format
+	QString Find(QString const& model) const;
+	//every indexed file with the base name of model
+	QStringList Matches(QString const& model) const;
+
+	qsizetype size() const { return m_count; }
+
+	static QStringList const& NameFilters();
+
+private:
+	QHash<QString, QStringList> m_models;
+	qsizetype m_count{ 0 };
+	QStringList m_roots;
+	QHash<QString, QDateTime> m_folders;	//adding or removing a file or folder changes the mtime of its parent
+};
+
+#endif
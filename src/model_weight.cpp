@@ -0,0 +1,178 @@
+#include "model_weight.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <functional>
+
+namespace
+{
+	constexpr qint64 READ_CHUNK{ 1 << 20 };
+	//the STEP HEADER section and the VRML first line are well inside this
+	constexpr qsizetype HEADER_SIZE{ 64 * 1024 };
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	//calls scan for every chunk of the file, the first HEADER_SIZE bytes are kept in header
+	bool ReadChunks(QFile& file, QByteArray& header, std::function<void(char const*, qint64)> const& scan)
+	{
+		QByteArray buffer(READ_CHUNK, Qt::Uninitialized);
+		for (;;)
+		{
+			qint64 const read{ file.read(buffer.data(), READ_CHUNK) };
+			if (read < 0)
+			{
+				return false;
+			}
+			if (read == 0)
+			{
+				return true;
+			}
+			if (header.size() < HEADER_SIZE)
+			{
+				header.append(buffer.constData(), std::min<qsizetype>(static_cast<qsizetype>(read), HEADER_SIZE - header.size()));
+			}
+			scan(buffer.constData(), read);
+		}
+	}
+
+	//every statement of the DATA section that starts with '#' is one entity instance
+	void MeasureStep(QFile& file, ModelWeight& weight)
+	{
+		qint64 entities{ 0 };
+		bool inString{ false };
+		bool statementStart{ true };
+		QByteArray header;
+		bool const read{ ReadChunks(file, header, [&](char const* data, qint64 size)
+		{
+			for (qint64 i = 0; i < size; ++i)
+			{
+				char const c{ data[i] };
+				if (c == '\'')
+				{
+					//'' inside a string toggles twice and stays in the string
+					inString = !inString;
+					statementStart = false;
+				}
+				else if (inString)
+				{
+					continue;
+				}
+				else if (c == ';')
+				{
+					statementStart = true;
+				}
+				else if (statementStart && !IsSpace(c))
+				{
+					entities += c == '#' ? 1 : 0;
+					statementStart = false;
+				}
+			}
+		}) };
+		if (!read)
+		{
+			return;
+		}
+
+		weight.entities = entities;
+		static QRegularExpression const schema(R"(FILE_SCHEMA\s*\(\s*\(\s*'([^'\s{]+))");
+		auto const match{ schema.match(QString::fromLatin1(header)) };
+		weight.format = match.hasMatch() ? match.captured(1) : QString("STEP");
+	}
+
+	//"Shape" nodes, each one is a separate mesh for the viewer
+	void MeasureVrml(QFile& file, ModelWeight& weight)
+	{
+		static constexpr char keyword[]{ "Shape" };
+		constexpr int keywordSize{ sizeof(keyword) - 1 };
+
+		qint64 shapes{ 0 };
+		int matched{ 0 };
+		char previous{ ' ' };
+		char before{ ' ' };	//character in front of the current match
+		QByteArray header;
+		bool const read{ ReadChunks(file, header, [&](char const* data, qint64 size)
+		{
+			for (qint64 i = 0; i < size; ++i)
+			{
+				char const c{ data[i] };
+				if (matched == keywordSize)
+				{
+					if ((IsSpace(c) || c == '{') && (IsSpace(before) || before == '{' || before == '[' || before == ','))
+					{
+						++shapes;
+					}
+					matched = 0;
+				}
+				if (c == keyword[matched])
+				{
+					if (matched == 0)
+					{
+						before = previous;
+					}
+					++matched;
+				}
+				else
+				{
+					matched = c == keyword[0] ? 1 : 0;
+					before = previous;
+				}
+				previous = c;
+			}
+		}) };
+		if (!read)
+		{
+			return;
+		}
+
+		weight.entities = shapes;
+		auto const firstLine{ header.left(header.indexOf('\n')).trimmed() };
+		weight.format = firstLine.startsWith("#VRML") ? QString::fromLatin1(firstLine.mid(1)).section(' ', 0, 1) : QString("VRML");
+	}
+}
+
+QString ModelWeight::asString() const
+{
+	QString const size{ QString("%1 MB").arg(static_cast<double>(bytes) / (1024.0 * 1024.0), 0, 'f', 1) };
+	if (entities < 0)
+	{
+		return QString("%1 %2").arg(size).arg(format);
+	}
+	return QString("%1, %2 entities, %3").arg(size).arg(entities).arg(format);
+}
+
+namespace model_weight
+{
+	ModelWeight Measure(QString const& path)
+	{
+		ModelWeight weight;
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			return weight;
+		}
+		weight.opened = true;
+		weight.bytes = file.size();
+
+		QString const suffix{ QFileInfo(path).suffix().toLower() };
+		if (suffix == "step" || suffix == "stp")
+		{
+			MeasureStep(file, weight);
+		}
+		else if (suffix == "wrl")
+		{
+			MeasureVrml(file, weight);
+		}
+		else
+		{
+			//gzipped VRML, the size is all that can be told without inflating it
+			weight.format = suffix.toUpper();
+		}
+		return weight;
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef MODEL_WEIGHT_H
+#define MODEL_WEIGHT_H
+
+#include <QString>
+
+//How heavy a 3D model is to load: file size, entity count and the format named in its header
+struct ModelWeight
+{
+	qint64 bytes{ 0 };
+	qint64 entities{ -1 };	//STEP "#n=" instances or VRML Shape nodes, -1 if the format can't be counted (.wrz)
+	QString format;			//"AUTOMOTIVE_DESIGN", "VRML V2.0", ...
+	bool opened{ false };
+
+	QString asString() const;
+};
+
+namespace model_weight
+{
+	//streams the file in fixed size chunks, it is never loaded whole
+	ModelWeight Measure(QString const& path);
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include "name_matcher.h"
+
+#include <algorithm>
+
+void NameMatcher::Clear()
+{
+	m_names.clear();
+	m_trigramCounts.clear();
+	m_postings.clear();
+}
+
+std::vector<quint64> NameMatcher::Trigrams(QString const& name)
+{
+	//padded so short names and the start/end of a name still produce trigrams
+	QString const padded{ "  " + name.toLower() + " " };
+	std::vector<quint64> trigrams;
+	trigrams.reserve(static_cast<std::size_t>(padded.size()));
+	for (qsizetype i = 0; i + 2 < padded.size(); ++i)
+	{
+		trigrams.push_back(static_cast<quint64>(padded[i].unicode()) << 32 |
+			static_cast<quint64>(padded[i + 1].unicode()) << 16 |
+			static_cast<quint64>(padded[i + 2].unicode()));
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+	return trigrams;
+}
+
+void NameMatcher::Add(QString const& name)
+{
+	auto const id{ static_cast<quint32>(m_names.size()) };
+	auto const trigrams{ Trigrams(name) };
+	m_names.append(name);
+	m_trigramCounts.push_back(static_cast<quint32>(trigrams.size()));
+	for (auto const trigram : trigrams)
+	{
+		m_postings[trigram].push_back(id);
+	}
+}
+
+QStringList NameMatcher::Find(QString const& name, int count, double minScore) const
+{
+	auto const trigrams{ Trigrams(name) };
+	if (trigrams.empty() || m_names.isEmpty())
+	{
+		return QStringList();
+	}
+
+	//rarest trigrams first, the ones in most names ("_sm", "met") say little about which name is meant
+	std::vector<std::vector<quint32> const*> postings;
+	postings.reserve(trigrams.size());
+	for (auto const trigram : trigrams)
+	{
+		if (auto const found{ m_postings.constFind(trigram) }; found != m_postings.constEnd())
+		{
+			postings.push_back(&found.value());
+		}
+	}
+	std::sort(postings.begin(), postings.end(), [](auto const* lhs, auto const* rhs) { return lhs->size() < rhs->size(); });
+
+	//per thread scratch, only the touched slots are reset so a query doesn't pay for the whole index
+	thread_local std::vector<quint32> shared;
+	thread_local std::vector<quint32> touched;
+	shared.resize(static_cast<std::size_t>(m_names.size()), 0);
+	touched.clear();
+
+	//candidates come from the rarest lists until CANDIDATE_POSTINGS ids were read, at least one list is always read
+	std::size_t counted{ 0 };
+	for (std::size_t read{ 0 }; counted < postings.size(); ++counted)
+	{
+		if (counted > 0 && read + postings[counted]->size() > CANDIDATE_POSTINGS)
+		{
+			break;
+		}
+		read += postings[counted]->size();
+		for (auto const id : *postings[counted])
+		{
+			if (shared[id]++ == 0)
+			{
+				touched.push_back(id);
+			}
+		}
+	}
+
+	//the frequent lists are only searched for the candidates sharing the most rare trigrams, so a large index stays
+	//well below a millisecond per name; when every list fit in the budget all candidates are scored exactly
+	std::size_t scored{ touched.size() };
+	if (counted < postings.size())
+	{
+		scored = std::min(touched.size(), static_cast<std::size_t>(std::max(count, 0)) * CANDIDATES_PER_MATCH);
+		std::nth_element(touched.begin(), touched.begin() + static_cast<std::ptrdiff_t>(scored), touched.end(), [](quint32 lhs, quint32 rhs)
+			{ return shared[lhs] > shared[rhs] || (shared[lhs] == shared[rhs] && lhs < rhs); });
+	}
+
+	std::vector<std::pair<double, quint32>> ranked;
+	for (std::size_t i = 0; i < touched.size(); ++i)
+	{
+		auto const id{ touched[i] };
+		if (i < scored)
+		{
+			//posting lists are in id order
+			for (std::size_t list = counted; list < postings.size(); ++list)
+			{
+				if (std::binary_search(postings[list]->begin(), postings[list]->end(), id))
+				{
+					++shared[id];
+				}
+			}
+			double const score{ 2.0 * shared[id] / static_cast<double>(trigrams.size() + m_trigramCounts[id]) };
+			if (score >= minScore && m_names[id] != name)
+			{
+				ranked.emplace_back(score, id);
+			}
+		}
+		shared[id] = 0;
+	}
+
+	auto const keep{ std::min<std::size_t>(ranked.size(), static_cast<std::size_t>(std::max(count, 0))) };
+	std::partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end(), [](auto const& lhs, auto const& rhs)
+		{ return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second); });
+
+	QStringList matches;
+	for (std::size_t i = 0; i < keep; ++i)
+	{
+		matches.append(m_names[ranked[i].second]);
+	}
+	return matches;
+}
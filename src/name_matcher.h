@@ -0,0 +1,37 @@
+#ifndef NAME_MATCHER_H
+#define NAME_MATCHER_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+#include <vector>
+
+//Trigram index over "library:item" names, finds the closest known names for one that is missing
+class NameMatcher
+{
+public:
+	void Clear();
+	void Add(QString const& name);
+
+	//best first, at most count names sharing at least minScore (Dice coefficient) of their trigrams
+	//in a large index only the names sharing the most rare trigrams are scored, see CANDIDATE_POSTINGS
+	//safe to call from several threads once the index is built
+	QStringList Find(QString const& name, int count = 3, double minScore = 0.5) const;
+
+	qsizetype size() const { return m_names.size(); }
+
+private:
+	//ids read from the rarest posting lists to find candidates, the longer lists are only searched per candidate
+	static constexpr std::size_t CANDIDATE_POSTINGS{ 16384 };
+	//candidates per requested match that get scored once that budget is used up
+	static constexpr std::size_t CANDIDATES_PER_MATCH{ 32 };
+
+	static std::vector<quint64> Trigrams(QString const& name);
+
+	QStringList m_names;
+	std::vector<quint32> m_trigramCounts;
+	QHash<quint64, std::vector<quint32>> m_postings;
+};
+
+#endif
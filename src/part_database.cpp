@@ -0,0 +1,90 @@
+#include "part_database.h"
+
+int PartDatabase::Find(QString const& value, QString const& footprint) const
+{
+	return m_byKey.value(Key(value, footprint), -1);
+}
+
+int PartDatabase::FindValue(QString const& value) const
+{
+	return m_byValue.value(value, -1);
+}
+
+int PartDatabase::Append(PartInfo part)
+{
+	m_parts.push_back(std::move(part));
+	int const row{ static_cast<int>(m_parts.size()) - 1 };
+	Index(row);
+	return row;
+}
+
+bool PartDatabase::Add(PartInfo part)
+{
+	if (Find(part.value, part.footPrint) != -1)
+	{
+		return false;
+	}
+	Append(std::move(part));
+	return true;
+}
+
+bool PartDatabase::Replace(int row, PartInfo part)
+{
+	if (row < 0 || row >= static_cast<int>(m_parts.size()))
+	{
+		return false;
+	}
+	auto& current{ m_parts[static_cast<std::size_t>(row)] };
+	bool const sameKey{ current.value == part.value && current.footPrint == part.footPrint };
+	current = std::move(part);
+	//a changed key can hand the first match of the old one to a later row
+	if (!sameKey)
+	{
+		Reindex();
+	}
+	return true;
+}
+
+bool PartDatabase::Remove(int row)
+{
+	if (row < 0 || row >= static_cast<int>(m_parts.size()))
+	{
+		return false;
+	}
+	m_parts.erase(m_parts.begin() + row);
+	Reindex();
+	return true;
+}
+
+void PartDatabase::Clear()
+{
+	m_parts.clear();
+	m_byKey.clear();
+	m_byValue.clear();
+}
+
+void PartDatabase::Index(int row)
+{
+	auto const& part{ m_parts[static_cast<std::size_t>(row)] };
+	//earlier rows win, an existing entry is never overwritten
+	if (!m_byKey.contains(Key(part.value, part.footPrint)))
+	{
+		m_byKey.insert(Key(part.value, part.footPrint), row);
+	}
+	if (!m_byValue.contains(part.value))
+	{
+		m_byValue.insert(part.value, row);
+	}
+}
+
+void PartDatabase::Reindex()
+{
+	m_byKey.clear();
+	m_byValue.clear();
+	m_byKey.reserve(static_cast<int>(m_parts.size()));
+	m_byValue.reserve(static_cast<int>(m_parts.size()));
+	for (int row = 0; row < static_cast<int>(m_parts.size()); ++row)
+	{
+		Index(row);
+	}
+}
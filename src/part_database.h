@@ -0,0 +1,47 @@
+#ifndef PART_DATABASE_H
+#define PART_DATABASE_H
+
+#include "partinfo.h"
+
+#include <QString>
+#include <QHash>
+#include <QPair>
+
+#include <vector>
+
+//Part number list in row order with hash indexes on (value, footprint) and on value
+//rows may share a key (json files, edited rows), lookups return the first row like the old linear search
+class PartDatabase
+{
+public:
+	//row of the first part with value and footprint, -1 if there is none
+	int Find(QString const& value, QString const& footprint) const;
+	//row of the first part with value, any footprint
+	int FindValue(QString const& value) const;
+
+	//appends part, returns its row
+	int Append(PartInfo part);
+	//appends part unless value and footprint are already listed, returns false then and leaves the list unchanged
+	bool Add(PartInfo part);
+	//replaces row, false if row is out of range
+	bool Replace(int row, PartInfo part);
+	bool Remove(int row);
+	void Clear();
+
+	PartInfo const& at(int row) const { return m_parts[static_cast<std::size_t>(row)]; }
+	std::vector<PartInfo> const& parts() const { return m_parts; }
+	std::size_t size() const { return m_parts.size(); }
+	bool empty() const { return m_parts.empty(); }
+
+private:
+	using Key = QPair<QString, QString>;
+
+	std::vector<PartInfo> m_parts;
+	QHash<Key, int> m_byKey;
+	QHash<QString, int> m_byValue;
+
+	void Index(int row);
+	void Reindex();
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "path_resolver.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcessEnvironment>
+#include <QStandardPaths>
+
+namespace
+{
+	constexpr const char* PROJECT_VAR = "KIPRJMOD";
+
+	QHash<QString, QString> ReadObject(QString const& fileName, QString const& section, QString const& key)
+	{
+		QHash<QString, QString> values;
+		QFile file(fileName);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			return values;
+		}
+		auto object{ QJsonDocument::fromJson(file.readAll()).object() };
+		if (!section.isEmpty())
+		{
+			object = object.value(section).toObject();
+		}
+		auto const vars{ object.value(key).toObject() };
+		for (auto it{ vars.begin() }; it != vars.end(); ++it)
+		{
+			if (it.value().isString())
+			{
+				values.insert(it.key(), it.value().toString());
+			}
+		}
+		return values;
+	}
+}
+
+PathResolver::PathResolver(QString const& dataPath)
+{
+	LoadDefaults(dataPath);
+	LoadCommonSettings();
+
+	auto const environment{ QProcessEnvironment::systemEnvironment() };
+	for (auto const& name : environment.keys())
+	{
+		m_environment.insert(name, environment.value(name));
+	}
+}
+
+void PathResolver::LoadDefaults(QString const& dataPath)
+{
+	//every KiCad version names the same folders with its own prefix
+	for (auto const& version : { "6", "7", "8", "9" })
+	{
+		QString const prefix{ QString("KICAD%1_").arg(version) };
+		m_defaults.insert(prefix + "FOOTPRINT_DIR", dataPath + "/footprints");
+		m_defaults.insert(prefix + "SYMBOL_DIR", dataPath + "/symbols");
+		m_defaults.insert(prefix + "3DMODEL_DIR", dataPath + "/3dmodels");
+		m_defaults.insert(prefix + "TEMPLATE_DIR", dataPath + "/template");
+	}
+	m_defaults.insert("KISYS3DMOD", dataPath + "/3dmodels");
+	m_defaults.insert("KICAD_TEMPLATE_DIR", dataPath + "/template");
+}
+
+void PathResolver::LoadCommonSettings()
+{
+	//<config>/kicad/<version>/kicad_common.json, newer versions override older ones
+#if defined( Q_OS_WIN )
+	//KiCad keeps its settings in the roaming profile, GenericConfigLocation is AppData/Local
+	m_configFolder = qEnvironmentVariable("APPDATA") + "/kicad";
+#elif defined( Q_OS_DARWIN )
+	m_configFolder = QDir::homePath() + "/Library/Preferences/kicad";
+#else
+	m_configFolder = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + "/kicad";
+#endif
+	for (auto const& version : { "6.0", "7.0", "8.0", "9.0" })
+	{
+		QString const fileName{ QString("%1/%2/kicad_common.json").arg(m_configFolder).arg(version) };
+		if (!QFile::exists(fileName))
+		{
+			continue;
+		}
+		m_commonFiles.append(fileName);
+		auto const vars{ ReadObject(fileName, "environment", "vars") };
+		for (auto it{ vars.begin() }; it != vars.end(); ++it)
+		{
+			m_common.insert(it.key(), it.value());
+		}
+	}
+}
+
+void PathResolver::LoadProjectVariables(QString const& folder)
+{
+	m_project.clear();
+	auto const projects{ QDir(folder).entryInfoList({ "*.kicad_pro" }, QDir::Files) };
+	if (!projects.isEmpty())
+	{
+		m_project = ReadObject(projects.first().absoluteFilePath(), QString(), "text_variables");
+	}
+}
+
+void PathResolver::SetProject(QString const& folder)
+{
+	std::lock_guard<std::mutex> const lock(m_lock);
+	m_projectFolder = folder;
+	LoadProjectVariables(folder);
+	m_resolved.clear();
+	m_relative.clear();
+}
+
+QString PathResolver::Variable(QString const& name) const
+{
+	if (name == PROJECT_VAR)
+	{
+		return m_projectFolder;
+	}
+	for (auto const* vars : { &m_project, &m_environment, &m_common, &m_defaults })
+	{
+		if (auto const found{ vars->constFind(name) }; found != vars->constEnd())
+		{
+			return found.value();
+		}
+	}
+	return QString();
+}
+
+QString PathResolver::Expand(QString const& path) const
+{
+	if (!path.contains("${"))
+	{
+		return path;
+	}
+
+	QString result;
+	result.reserve(path.size());
+	qsizetype pos{ 0 };
+	while (pos < path.size())
+	{
+		qsizetype const start{ path.indexOf("${", pos) };
+		qsizetype const end{ start < 0 ? -1 : path.indexOf('}', start) };
+		if (end < 0)
+		{
+			result.append(path.mid(pos));
+			break;
+		}
+		result.append(path.mid(pos, start - pos));
+
+		QString const name{ path.mid(start + 2, end - start - 2) };
+		QString const value{ Variable(name) };
+		//unknown names stay so the caller still sees what was missing
+		result.append(value.isEmpty() && name != PROJECT_VAR ? path.mid(start, end - start + 1) : value);
+		pos = end + 1;
+	}
+	return result;
+}
+
+QString PathResolver::Resolve(QString const& path)
+{
+	std::lock_guard<std::mutex> const lock(m_lock);
+	if (auto const found{ m_resolved.constFind(path) }; found != m_resolved.constEnd())
+	{
+		return found.value();
+	}
+	QString resolved{ Expand(path) };
+	m_resolved.insert(path, resolved);
+	return resolved;
+}
+
+QString PathResolver::Relative(QString const& path, QString const& libraryPath)
+{
+	QString const key{ libraryPath + '\n' + path };
+	std::lock_guard<std::mutex> const lock(m_lock);
+	if (auto const found{ m_relative.constFind(key) }; found != m_relative.constEnd())
+	{
+		return found.value();
+	}
+	QString relative{ MakeRelative(path, libraryPath) };
+	m_relative.insert(key, relative);
+	return relative;
+}
+
+QString PathResolver::MakeRelative(QString const& path, QString const& libraryPath) const
+{
+	//if already using macros, avoid
+	if (path.startsWith("$") || libraryPath.isEmpty() || m_projectFolder.isEmpty())
+	{
+		return path;
+	}
+
+	QString const projectVar{ QString("${%1}").arg(PROJECT_VAR) };
+	//if its in a subfolder, easy to do find replace
+	if (path.startsWith(m_projectFolder + "/"))
+	{
+		return projectVar + path.mid(m_projectFolder.size());
+	}
+
+	//only paths inside the library folder are moved next to the project
+	if (!path.startsWith(libraryPath + "/"))
+	{
+		return path;
+	}
+	QString const relative{ QDir(m_projectFolder).relativeFilePath(path) };
+	if (QDir::isAbsolutePath(relative))
+	{
+		//another drive, nothing to be relative to
+		return path;
+	}
+	return projectVar + "/" + relative;
+}
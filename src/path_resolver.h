@@ -0,0 +1,52 @@
+#ifndef PATH_RESOLVER_H
+#define PATH_RESOLVER_H
+
+#include <QString>
+#include <QHash>
+#include <QStringList>
+
+#include <mutex>
+
+//Expands "${NAME}" in library and model paths and makes paths project relative, both memoized
+//Lookup order: KIPRJMOD, the project's text_variables, the process environment, kicad_common.json, built-in KiCad 6-9 defaults
+//Resolve/Relative may be called from several threads
+class PathResolver
+{
+public:
+	explicit PathResolver(QString const& dataPath);
+
+	//reads the text variables of the .kicad_pro in folder and forgets every memoized path
+	void SetProject(QString const& folder);
+
+	QString Resolve(QString const& path);
+	//path with the project folder or the library folder turned into ${KIPRJMOD}/.., unchanged if that isn't possible
+	QString Relative(QString const& path, QString const& libraryPath);
+
+	QString Variable(QString const& name) const;
+
+	//folder searched for <version>/kicad_common.json and the files that were found there
+	QString const& configFolder() const { return m_configFolder; }
+	QStringList const& commonSettings() const { return m_commonFiles; }
+
+private:
+	void LoadDefaults(QString const& dataPath);
+	void LoadCommonSettings();
+	void LoadProjectVariables(QString const& folder);
+
+	QString Expand(QString const& path) const;
+	QString MakeRelative(QString const& path, QString const& libraryPath) const;
+
+	QString m_projectFolder;
+	QString m_configFolder;
+	QStringList m_commonFiles;
+	QHash<QString, QString> m_defaults;
+	QHash<QString, QString> m_common;
+	QHash<QString, QString> m_environment;
+	QHash<QString, QString> m_project;
+
+	QHash<QString, QString> m_resolved;
+	QHash<QString, QString> m_relative;		//libraryPath + '\n' + path -> result
+	mutable std::mutex m_lock;
+};
+
+#endif
@@ -3,48 +3,38 @@
 #include "csvparser.h"
 
 #include "kicad_utils.h"
+#include "file_patch.h"
+#include "mapped_file.h"
+#include "sexpr_tokenizer.h"
 
 #include "ref_compare.h"
 
 #include <QFile>
 #include <QDir>
 #include <QTextStream>
-#include <QRegularExpression>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 
 SchematicAdder::SchematicAdder()
 {
-	//Regex to look through schematic property, if we hit the pin section without finding a LCSC property, add it
-	//keep track of property ids and Reference property location to use with new LCSC property
-
-	// R"(\\(property\\s\\"(.*)\\"\s\\"(.*)\\"\s\\(id\\s(\\d +)\\)\\s\\(at\\s(-?\\d+.\\d+\\s-?\\d+.\\d+)\s\\d+\\)"
-	//\(property\s\"(.*)\"\s\"(.*)\"\s\(id\s(\d+)\)\s\(at\s(-?\d+(?:.\d+)?\s-?\d+(?:.\d+)?)\s\d+\)
-	propRx = QRegularExpression (
-		R"(\(property\s\"(.*)\"\s\"(.*)\"\s\(at\s(-?\d+(?:.\d+)?\s-?\d+(?:.\d+)?)\s\d+\))"
-	);
-	pinRx = QRegularExpression (R"(\(pin\s\"(.*)\"\s\()");
 }
 
 void SchematicAdder::AddPart(PartInfo part)
 {
-	if (std::any_of(partList.begin(), partList.end(), [&](auto const& elem)
-		{ return elem.value == part.value && elem.footPrint == part.footPrint; })) {
-
+	if (!partList.Add(std::move(part)))
+	{
 		return;
 	}
-	partList.push_back(part);
 	emit RedrawPartList(true);
 }
 
 void SchematicAdder::RemovePart(int index)
 {
-	if (index < 0 || index > partList.size())
+	if (!partList.Remove(index))
 	{
 		return;
 	}
-	partList.erase(partList.begin() + index);
 	emit RedrawPartList(true);
 }
 
@@ -54,15 +44,10 @@ void SchematicAdder::UpdatePart(QString const& value, QString const& fp, QString
 	//	{ return elem.value == value && elem.footPrint == fp; })) {
 	//	return;
 	//}
-	if (index < 0 || index > partList.size())
+	if (!partList.Replace(index, PartInfo(value, fp, digi, lcsc, mpn)))
 	{
 		return;
 	}
-	partList.at(index).value = value;
-	partList.at(index).footPrint = fp;
-	partList.at(index).digikey = digi;
-	partList.at(index).lcsc = lcsc;
-	partList.at(index).mpn = mpn;
 	emit UpdatePartRow(index);
 }
 
@@ -91,207 +76,90 @@ bool SchematicAdder::AddPartNumbersToSchematics(QString const& schDir) const
 
 void SchematicAdder::UpdateSchematic(QString const& schPath) const
 {
-	//int lastID{ -1 };
-	QString lastLoc;
-	QString lastDigikey;
-	QString newDigikey;
-	QString lastLcsc;
-	QString newLcsc;
-	QString lastMPN;
-	QString newMPN;
-	QString lastRef;
-	QString lastValue;
-
-	std::vector<QString> lines;
-	std::vector<QString> newlines;
-
-	QFile inFile(schPath);
-
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	QByteArray contents;
 	{
-		emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-		return;
+		MappedFile const inFile(schPath);
+		if (!inFile.isOpen())
+		{
+			emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
+			return;
+		}
+
+		auto const patches{ CreatePatches(inFile.data(), *SchematicDocument::Parse(schPath, inFile.data())) };
+		if (patches.empty())
+		{
+			emit SendMessage(QString("No PN changes in '%1'").arg(schPath), spdlog::level::level_enum::debug, schPath);
+			return;
+		}
+		contents = file_patch::Apply(inFile.data(), patches);
 	}
-	QTextStream in(&inFile);
-	while (!in.atEnd())
+
+	if (QString error; !file_patch::WriteWithBackup(schPath, contents, error))
 	{
-		lines.emplace_back(in.readLine());
+		emit SendMessage(error, spdlog::level::level_enum::warn, schPath);
 	}
-	inFile.close();
+}
 
-	bool partSection{false};
-	for (auto const& line : lines)
-	{
-		QString outLine = line;
-		QRegularExpressionMatch m = propRx.match(line);
+std::vector<FilePatch> SchematicAdder::CreatePatches(std::string_view data, SchematicDocument const& document) const
+{
+	std::vector<FilePatch> patches;
+	QByteArray const newline{ file_patch::LineEnding(data) };
 
-		if(line.contains("(symbol (lib_id"))
+	for (auto const& component : document.components())
+	{
+		PartInfo const* part{ nullptr };
+		if (int const row{ partList.Find(component.value, component.footprint) }; row != -1)
 		{
-			partSection = true;
+			part = &partList.at(row);
+			emit SendMessage(QString("Part Found based on FootPrint '%1':'%2'").arg(part->value).arg(part->footPrint), spdlog::level::level_enum::debug, QString());
 		}
-
-		if (m.hasMatch() && line.startsWith("    (property") && partSection)
+		else if (int const valueRow{ partList.FindValue(component.value) }; valueRow != -1)
 		{
-			auto key = m.captured(1);
-			auto	value = m.captured(2);
-			//auto slastID = m.captured(3);
-			//lastID = m.captured(3).toInt();
-
-			if (key == "Digi-Key_PN")
-			{
-				lastDigikey = value;
-				if (lastDigikey != newDigikey && !newDigikey.isEmpty())
-				{
-					emit SendMessage(QString("Updating '%1' Digikey to '%2'").arg(lastRef).arg(newDigikey), spdlog::level::level_enum::debug, QString());
-					outLine.replace("\"" + lastDigikey + "\"", "\"" + newDigikey + "\"");
-					lastDigikey = newDigikey;
-				}
-			}
-			if (key == "LCSC")
-			{
-				lastLcsc = value;
-				if (lastLcsc != newLcsc && !newLcsc.isEmpty())
-				{
-					emit SendMessage(QString("Updating '%1' LCSC to '%2'").arg(lastRef).arg(newLcsc), spdlog::level::level_enum::debug, QString());
-					outLine.replace("\"" + lastLcsc + "\"", "\"" + newLcsc + "\"");
-					lastLcsc = newLcsc;
-				}
-			}
-			if (key == "MPN")
-			{
-				lastMPN = value;
-				if (lastMPN != newMPN && !newMPN.isEmpty())
-				{
-					emit SendMessage(QString("Updating '%1' MPN to '%2'").arg(lastRef).arg(newMPN), spdlog::level::level_enum::debug, QString());
-					outLine.replace("\"" + lastMPN + "\"", "\"" + newMPN + "\"");
-					lastMPN = newMPN;
-				}
-			}
+			part = &partList.at(valueRow);
+			emit SendMessage(QString("Part Found based on Value '%1':'%2'").arg(part->value).arg(part->footPrint), spdlog::level::level_enum::debug, QString());
+		}
+		if (part == nullptr || component.properties.empty())
+		{
+			continue;
+		}
 
-			if (key == "Reference")
-			{
-				lastLoc = m.captured(3);
-				lastRef = value;
-			}
-			if (key == "Value")
+		//existing properties get their value token replaced, missing ones are added after the last property
+		QByteArray added;
+		auto const setProperty = [&](QString const& key, QString const& label, QString const& newValue)
+		{
+			if (newValue.isEmpty())
 			{
-				lastValue = value;
-				//for (auto const& part : partList) {
-				//	if (value == part.value)
-				//	{
-				//		newDigikey = part.digikey;
-				//		newLcsc = part.lcsc;
-				//		newMPN = part.mpn;
-				//		break;
-				//	}
-				//}
+				return;
 			}
-			if (key == "Footprint")
+			if (auto const* prop{ component.findProperty(key) }; prop != nullptr)
 			{
-				bool found{false};
-				for (auto const& part : partList)
-				{
-					if (lastValue == part.value && value == part.footPrint)
-					{
-						newDigikey = part.digikey;
-						newLcsc = part.lcsc;
-						newMPN = part.mpn;
-						found = true;
-						emit SendMessage(QString("Part Found based on FootPrint '%1':'%2'").arg(part.value).arg(part.footPrint), spdlog::level::level_enum::debug, QString());
-						break;
-					}
-				}
-				if(!found)
+				if (prop->value != newValue)
 				{
-					for (auto const& part : partList)
-					{
-						if (lastValue == part.value)
-						{
-							newDigikey = part.digikey;
-							newLcsc = part.lcsc;
-							newMPN = part.mpn;
-							emit SendMessage(QString("Part Found based on Value '%1':'%2'").arg(part.value).arg(part.footPrint), spdlog::level::level_enum::debug, QString());
-							break;
-						}
-					}
+					emit SendMessage(QString("Updating '%1' %2 to '%3'").arg(component.reference).arg(label).arg(newValue), spdlog::level::level_enum::debug, QString());
+					patches.push_back({ prop->valueOffset, prop->valueLength, SexprTokenizer::Encode(newValue) });
 				}
+				return;
 			}
-		}
-
-		QRegularExpressionMatch pm = pinRx.match(line);
-
-		bool addDigi = lastDigikey.isEmpty() && !newDigikey.isEmpty();
-		bool addLcsc = lastLcsc.isEmpty() && !newLcsc.isEmpty();
-		bool addMPN = lastMPN.isEmpty() && !newMPN.isEmpty();
-
-		if (pm.hasMatch())
-		{
-			if ((addDigi || addLcsc || addMPN) && !lastLoc.isEmpty())
+			auto const* reference{ component.findProperty("Reference") };
+			if (reference == nullptr || reference->position.isEmpty())
 			{
-				if (addDigi)
-				{
-					emit SendMessage(QString("Adding '%1' DigiKey '%2'").arg(lastRef).arg(newDigikey), spdlog::level::level_enum::debug, QString());
-					QString newTxt = QString("    (property \"Digi-Key_PN\" \"%1\" (at %2 0)").arg(newDigikey).arg(lastLoc);
-					newlines.push_back(newTxt);
-					newlines.push_back("      (effects (font (size 1.27 1.27)) hide)");
-					newlines.push_back("    )");
-				}
-				if (addLcsc)
-				{
-					emit SendMessage(QString("Adding '%1' LCSC '%2'").arg(lastRef).arg(newLcsc), spdlog::level::level_enum::debug, QString());
-					QString newTxt = QString("    (property \"LCSC\" \"%1\" (at %2 0)").arg(newLcsc).arg(lastLoc);
-					newlines.push_back(newTxt);
-					newlines.push_back("      (effects (font (size 1.27 1.27)) hide)");
-					newlines.push_back("    )");
-				}
-				if (addMPN)
-				{
-					emit SendMessage(QString("Adding '%1' MPN '%2'").arg(lastRef).arg(newMPN), spdlog::level::level_enum::debug, QString());
-					QString newTxt = QString("    (property \"MPN\" \"%1\" (at %32 0)").arg(newMPN).arg(lastLoc);
-					newlines.push_back(newTxt);
-					newlines.push_back("      (effects (font (size 1.27 1.27)) hide)");
-					newlines.push_back("    )");
-				}
+				return;
 			}
-			lastDigikey = "";
-			newDigikey = "";
-			lastLcsc = "";
-			newLcsc = "";
-			lastMPN = "";
-			newMPN = "";
-			
-			lastLoc = "";
-			lastRef = "";
-			lastValue = "";
-		}
-		newlines.push_back(outLine);
-	}
-
-	try
-	{
-		if (QFile::exists(schPath + "_old"))
+			emit SendMessage(QString("Adding '%1' %2 '%3'").arg(component.reference).arg(label).arg(newValue), spdlog::level::level_enum::debug, QString());
+			added += newline + "    (property " + SexprTokenizer::Encode(key) + " " + SexprTokenizer::Encode(newValue) + " (at " + reference->position.toUtf8() + " 0)";
+			added += newline + "      (effects (font (size 1.27 1.27)) hide)";
+			added += newline + "    )";
+		};
+		setProperty("Digi-Key_PN", "Digikey", part->digikey);
+		setProperty("LCSC", "LCSC", part->lcsc);
+		setProperty("MPN", "MPN", part->mpn);
+
+		if (!added.isEmpty())
 		{
-			QFile::remove(schPath + "_old");
+			patches.push_back({ component.properties.back().endOffset, 0, std::move(added) });
 		}
-
-		QFile::rename(schPath, schPath + "_old");
-	}
-	catch (std::exception /*ex*/)
-	{
-		emit SendMessage(QString("Could not Create '%1_old'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-	}
-
-	QFile outFile(schPath);
-	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text))
-	{
-		emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-		return;
 	}
-	QTextStream out(&outFile);
-	for (auto const& line : newlines) {
-		out << line << "\n";
-	}
-	outFile.close();
+	return patches;
 }
 
 void SchematicAdder::LoadJsonFile(const QString& jsonFile)
@@ -335,7 +203,7 @@ void SchematicAdder::SaveJsonFile(const QString& jsonFile) const
 void SchematicAdder::write(QJsonObject& json) const
 {
 	QJsonArray partArray;
-	for (auto const& part : partList)
+	for (auto const& part : partList.parts())
 	{
 		QJsonObject partObj;
 		part.write(partObj);
@@ -346,13 +214,13 @@ void SchematicAdder::write(QJsonObject& json) const
 
 void SchematicAdder::read(QJsonObject const& json)
 {
-	partList.clear();
+	partList.Clear();
 
 	QJsonArray partArray = json["parts"].toArray();
 	for (auto const& part : partArray)
 	{
 		QJsonObject npcObject = part.toObject();
-		partList.emplace_back(npcObject);
+		partList.Append(PartInfo(npcObject));
 	}
 }
 
@@ -420,17 +288,15 @@ void SchematicAdder::ImportPartNumerCSV(QString const& csvFile, bool overidePart
 			lcsc = line[2].c_str();
 			lcsc = kicad_utils::CleanQuotes(lcsc);
 		}
-		if (auto const found { std::find_if(partList.begin(), partList.end(), [&](auto const & elem)
-							{ return elem.value == value && elem.footPrint == footp; })};found == partList.end())
+		if (int const found { partList.Find(value, footp) }; found == -1)
 		{
-			partList.emplace_back(std::move(value), std::move(footp), std::move(digi), std::move(lcsc), std::move(mpn));
+			partList.Append(PartInfo(std::move(value), std::move(footp), std::move(digi), std::move(lcsc), std::move(mpn)));
 		}
 		else
 		{
 			if(overideParts)
 			{
-				auto index = std::distance(partList.begin(), found);
-				partList[index] = std::move(PartInfo(std::move(value), std::move(footp), std::move(digi), std::move(lcsc), std::move(mpn)));
+				partList.Replace(found, PartInfo(std::move(value), std::move(footp), std::move(digi), std::move(lcsc), std::move(mpn)));
 			}
 		}
 	}
@@ -442,104 +308,41 @@ void SchematicAdder::ImportSchematicParts(QStringList const& schFiles, bool over
 	bool added {false};
 	for(auto const& schPath : schFiles)
 	{
-		QString lastDigikey;
-		QString lastLcsc;
-		QString lastMPN;
-		QString lastRef;
-		QString lastValue;
-		QString lastFP;
-
-		std::vector<QString> lines;
-
-		QFile inFile(schPath);
-
-		if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-		{
-			emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-			return;
-		}
-		QTextStream in(&inFile);
-		while (!in.atEnd())
+		auto const document{ LoadSchematic(schPath) };
+		if (!document)
 		{
-			lines.emplace_back(in.readLine());
+			continue;
 		}
-		inFile.close();
 		emit SendMessage("Importing From: " + schPath, spdlog::level::level_enum::debug, schPath);
 
-		bool partSection{false};
-		for (auto const& line : lines)
+		for (auto const& component : document->components())
 		{
-			QString outLine = line;
-			QRegularExpressionMatch m = propRx.match(line);
+			QString const lastDigikey{ component.property("Digi-Key_PN") };
+			QString const lastLcsc{ component.property("LCSC") };
+			QString const lastMPN{ component.property("MPN") };
+			QString const& lastValue{ component.value };
+			QString const& lastFP{ component.footprint };
 
-			if(line.contains("(symbol (lib_id"))
+			if (lastValue.isEmpty() || lastFP.isEmpty())
 			{
-				partSection = true;
+				continue;
 			}
-
-			if (m.hasMatch() && partSection)
+			if (lastDigikey.isEmpty() && lastLcsc.isEmpty() && lastMPN.isEmpty())
 			{
-				auto key = m.captured(1);
-				auto	value = m.captured(2);
-
-				if (key == "Digi-Key_PN")
-				{
-					lastDigikey = value;
-				}
-				if (key == "LCSC")
-				{
-					lastLcsc = value;
-				}
-				if (key == "MPN")
-				{
-					lastMPN = value;
-				}
-
-				if (key == "Reference")
-				{
-					lastRef = value;
-				}
-				if (key == "Value")
-				{
-					lastValue = value;
-				}
-				if (key == "Footprint")
-				{
-					lastFP = value;
-				}
+				continue;
 			}
-
-			QRegularExpressionMatch pm = pinRx.match(line);
-
-			if (pm.hasMatch())
+			if (int const found { partList.Find(lastValue, lastFP) }; found == -1)
+			{
+				partList.Append(PartInfo(lastValue, lastFP,lastDigikey, lastLcsc, lastMPN ));
+				added = true;
+			}
+			else
 			{
-				if (!lastValue.isEmpty() && !lastFP.isEmpty())
+				if(overideParts)
 				{
-					if (!lastDigikey.isEmpty() || !lastLcsc.isEmpty() || !lastMPN.isEmpty())
-					{
-						if (auto const found { std::find_if(partList.begin(), partList.end(), [&](auto const & elem)
-							{ return elem.value == lastValue && elem.footPrint == lastFP; })};found == partList.end())
-						{
-							partList.emplace_back(lastValue, lastFP,lastDigikey, lastLcsc, lastMPN );
-							added = true;
-						}
-						else
-						{
-							if(overideParts)
-							{
-								auto index = std::distance(partList.begin(), found);
-								partList[index] = std::move(PartInfo(lastValue, lastFP,lastDigikey, lastLcsc, lastMPN));
-								added = true;
-							}
-						}
-					}
+					partList.Replace(found, PartInfo(lastValue, lastFP,lastDigikey, lastLcsc, lastMPN));
+					added = true;
 				}
-				lastDigikey = "";
-				lastLcsc = "";
-				lastMPN = "";
-				lastRef = "";
-				lastValue ="";
-				lastFP ="";
 			}
 		}
 	}
@@ -564,7 +367,7 @@ void SchematicAdder::SavePartNumerCSV(QString const& fileName) const
 	QTextStream out(&outFile);
 	//"Value","Footprint","Digi-Key_PN","LCSC","MPN"
 	out << "\"Value\",\"Footprint\",\"Digi-Key_PN\",\"LCSC\",\"MPN\"\n";
-	for (auto const& part : partList)
+	for (auto const& part : partList.parts())
 	{
 		out << part.asString() << "\n";
 	}
@@ -597,88 +400,29 @@ void SchematicAdder::GenerateBOM(QString const& fileName, QString const& schDir)
 
 void SchematicAdder::ParseForBOM(QString const& fileName)
 {
-	QString lastDigikey;
-	QString lastLcsc;
-	QString lastMPN;
-	QString lastRef;
-	QString lastValue;
-	QString lastFP;
-
-	std::vector<QString> lines;
-
-	QFile inFile(fileName);
-
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	auto const document{ LoadSchematic(fileName) };
+	if (!document)
 	{
-		emit SendMessage(QString("Could not Open '%1'").arg(fileName), spdlog::level::level_enum::warn, fileName);
 		return;
 	}
-	QTextStream in(&inFile);
-	while (!in.atEnd())
+	for (auto const& component : document->components())
 	{
-		lines.emplace_back(in.readLine());
-	}
-	inFile.close();
-
-	bool partSection{ false };
-	for (auto const& line : lines)
-	{
-		QString outLine = line;
-		QRegularExpressionMatch m = propRx.match(line);
-
-		if (line.contains("(symbol (lib_id"))
-		{
-			partSection = true;
-		}
-
-		if (m.hasMatch() && partSection)
+		if (!component.value.isEmpty() && !component.footprint.isEmpty() && !component.reference.isEmpty())
 		{
-			auto key = m.captured(1);
-			auto	value = m.captured(2);
-
-			if (key == "Digi-Key_PN")
-			{
-				lastDigikey = value;
-			}
-			if (key == "LCSC")
-			{
-				lastLcsc = value;
-			}
-			if (key == "MPN")
-			{
-				lastMPN = value;
-			}
-
-			if (key == "Reference")
-			{
-				lastRef = value;
-			}
-			if (key == "Value")
-			{
-				lastValue = value;
-			}
-			if (key == "Footprint")
-			{
-				lastFP = value;
-			}
+			AddorUpdateBOM(component.value, component.footprint, component.reference,
+				component.property("Digi-Key_PN"), component.property("LCSC"), component.property("MPN"));
 		}
+	}
+}
 
-		QRegularExpressionMatch pm = pinRx.match(line);
-
-		if (pm.hasMatch())
-		{
-			if (!lastValue.isEmpty() && !lastFP.isEmpty() && !lastRef.isEmpty())
-			{
-				AddorUpdateBOM(lastValue, lastFP, lastRef, lastDigikey, lastLcsc, lastMPN);
-			}
-			lastDigikey = "";
-			lastLcsc = "";
-			lastMPN = "";
-			lastRef = "";
-			lastValue = "";
-			lastFP = "";
-		}
+std::shared_ptr<SchematicDocument const> SchematicAdder::LoadSchematic(QString const& schPath) const
+{
+	auto document{ m_documents->Get(schPath) };
+	if (!document)
+	{
+		emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
 	}
+	return document;
 }
 
 void SchematicAdder::AddorUpdateBOM(QString value_, QString footPrint_, QString const& ref_, QString digikey_, QString lcsc_, QString mpn_)
@@ -2,13 +2,18 @@
 #define SCHEMATIC_ADDER_H
 
 #include "partinfo.h"
+#include "part_database.h"
 #include "bom_item.h"
+#include "schematic_document.h"
+#include "file_patch.h"
 
 #include "spdlog/spdlog.h"
 
 #include <QString>
 #include <QObject>
 
+#include <memory>
+
 class SchematicAdder : public QObject
 {
 Q_OBJECT
@@ -31,8 +36,9 @@ public:
 
 	void GenerateBOM(QString const& fileName, QString const& schDir);
 
-	void ClearPartList(){ partList.clear(); }
-	std::vector<PartInfo> const& getPartList() const { return partList; }
+	void ClearPartList(){ partList.Clear(); }
+	void SetDocumentCache(std::shared_ptr<SchematicDocumentCache> documents) { m_documents = std::move(documents); }
+	std::vector<PartInfo> const& getPartList() const { return partList.parts(); }
 
 Q_SIGNALS:
 	void SendMessage( QString const& message, spdlog::level::level_enum llvl, QString const& file) const;
@@ -40,13 +46,14 @@ Q_SIGNALS:
 	void UpdatePartRow(int index) const;
 
 private:
-	std::vector<PartInfo> partList;
+	PartDatabase partList;
 	std::vector<BOMItem> bomList;
 
-	QRegularExpression propRx;
-	QRegularExpression pinRx;
+	std::shared_ptr<SchematicDocumentCache> m_documents{ std::make_shared<SchematicDocumentCache>() };
 
+	std::shared_ptr<SchematicDocument const> LoadSchematic(QString const& schPath) const;
 	void UpdateSchematic(QString const& schPath) const;
+	std::vector<FilePatch> CreatePatches(std::string_view data, SchematicDocument const& document) const;
 	void write(QJsonObject& json) const;
 	void read(QJsonObject const& json);
 
@@ -0,0 +1,312 @@
+#include "schematic_document.h"
+
+#include "mapped_file.h"
+#include "marker_scanner.h"
+#include "sexpr_tokenizer.h"
+
+#include <QFileInfo>
+
+namespace
+{
+	//"(instances (project "name" (path "/root/sheet" (reference "R1") (unit 1))))" or the
+	//root "(symbol_instances (path "/sheet/symbol" (reference "R1") ...))", called just after the keyword
+	void ReadInstances(SexprTokenizer& tokens, std::vector<SymbolInstance>& instances)
+	{
+		int const depth{ tokens.depth() };
+		QString project;
+		QString path;
+		for (auto token{ tokens.Next() }; !token.isEnd() && tokens.depth() >= depth; token = tokens.Next())
+		{
+			if (!token.isOpen())
+			{
+				continue;
+			}
+			auto const key{ tokens.Next() };
+			if (key.isAtom("project") || key.isAtom("path"))
+			{
+				auto const name{ tokens.Next() };
+				if (!name.isClose())
+				{
+					(key.isAtom("project") ? project : path) = name.toQString();
+				}
+				//the children are read by this loop
+				continue;
+			}
+			if (key.isAtom("reference"))
+			{
+				auto const reference{ tokens.Next() };
+				if (reference.isClose())
+				{
+					continue;
+				}
+				instances.push_back({ project, path, reference.toQString() });
+			}
+			if (!key.isClose())
+			{
+				tokens.SkipList();
+			}
+		}
+	}
+
+	//the file of a "(sheet" block, "Sheetfile" since KiCad 7, "Sheet file" before
+	QString ReadSheetFile(SexprTokenizer& tokens)
+	{
+		QString file;
+		for (auto token{ tokens.Next() }; !token.isEnd() && tokens.depth() > 0; token = tokens.Next())
+		{
+			if (!token.isOpen())
+			{
+				continue;
+			}
+			auto const key{ tokens.Next() };
+			if (key.isClose())
+			{
+				continue;
+			}
+			if (key.isAtom("property"))
+			{
+				auto const name{ tokens.Next() };
+				auto const value{ name.isValue() ? tokens.Next() : name };
+				if ((name.isString("Sheetfile") || name.isString("Sheet file")) && value.isValue())
+				{
+					file = value.toQString();
+				}
+				if (name.isClose() || value.isClose())
+				{
+					continue;
+				}
+			}
+			tokens.SkipList();
+		}
+		return file;
+	}
+}
+
+SchematicProperty const* SchematicComponent::findProperty(QString const& name) const
+{
+	for (auto const& prop : properties)
+	{
+		if (prop.name == name)
+		{
+			return &prop;
+		}
+	}
+	return nullptr;
+}
+
+QString SchematicComponent::property(QString const& name) const
+{
+	auto const* prop{ findProperty(name) };
+	return prop != nullptr ? prop->value : QString();
+}
+
+std::shared_ptr<SchematicDocument const> SchematicDocument::Load(QString const& path)
+{
+	QFileInfo const fileData(path);
+	MappedFile const inFile(path);
+	if (!inFile.isOpen())
+	{
+		return nullptr;
+	}
+
+	auto document{ std::const_pointer_cast<SchematicDocument>(Parse(path, inFile.data())) };
+	document->m_fileSize = fileData.size();
+	document->m_lastModified = fileData.lastModified();
+	return document;
+}
+
+std::shared_ptr<SchematicDocument const> SchematicDocument::Parse(QString const& path, std::string_view data)
+{
+	auto document{ std::make_shared<SchematicDocument>() };
+	document->m_path = path;
+	document->m_fileName = QFileInfo(path).fileName();
+
+	//placed symbols start with "(symbol (lib_id", lib_symbols entries are "(symbol "Device:R"" and get skipped
+	static MarkerScanner const markers{ "symbol", "sheet", "symbol_instances" };
+	std::size_t symbolEnd{ 0 };
+	for (auto const offset : markers.Scan(data))
+	{
+		if (offset < symbolEnd)
+		{
+			continue;
+		}
+		SexprTokenizer tokens(data, offset);
+		tokens.Next();
+		auto const keyword{ tokens.Next() };
+		if (keyword.isAtom("sheet"))
+		{
+			if (QString const file{ ReadSheetFile(tokens) }; !file.isEmpty())
+			{
+				document->m_sheetFiles.append(file);
+			}
+			symbolEnd = tokens.position();
+			continue;
+		}
+		if (keyword.isAtom("symbol_instances"))
+		{
+			ReadInstances(tokens, document->m_symbolInstances);
+			symbolEnd = tokens.position();
+			continue;
+		}
+		if (!keyword.isAtom("symbol") || !tokens.AtList("lib_id"))
+		{
+			continue;
+		}
+
+		auto& component{ document->m_components.emplace_back() };
+		component.offset = offset;
+		for (auto token{ tokens.Next() }; !token.isEnd() && tokens.depth() > 0; token = tokens.Next())
+		{
+			if (!token.isOpen())
+			{
+				continue;
+			}
+			auto const key{ tokens.Next() };
+			if (key.isAtom("lib_id"))
+			{
+				auto const libId{ tokens.Next() };
+				if (libId.isClose())
+				{
+					continue;
+				}
+				component.libId = libId.toQString();
+				tokens.SkipList();
+				continue;
+			}
+			if (key.isAtom("uuid"))
+			{
+				auto const uuid{ tokens.Next() };
+				if (uuid.isClose())
+				{
+					continue;
+				}
+				component.uuid = uuid.toQString();
+				tokens.SkipList();
+				continue;
+			}
+			if (key.isAtom("on_board") || key.isAtom("exclude_from_board"))
+			{
+				//"(on_board no)", "(exclude_from_board yes)" or a bare "(exclude_from_board)"
+				auto const flag{ tokens.Next() };
+				if (key.isAtom("on_board") ? flag.isAtom("no") : (flag.isClose() || flag.isAtom("yes")))
+				{
+					component.onBoard = false;
+				}
+				if (!flag.isClose())
+				{
+					tokens.SkipList();
+				}
+				continue;
+			}
+			if (key.isAtom("instances"))
+			{
+				ReadInstances(tokens, component.instances);
+				continue;
+			}
+			if (!key.isAtom("property"))
+			{
+				tokens.SkipList();
+				continue;
+			}
+
+			auto const name{ tokens.Next() };
+			if (name.isClose())
+			{
+				continue;
+			}
+			auto const value{ tokens.Next() };
+			if (value.isClose())
+			{
+				continue;
+			}
+			std::size_t const valueEnd{ tokens.position() };
+			QString position;
+			int const propertyDepth{ tokens.depth() };
+			for (auto child{ tokens.Next() }; !child.isEnd() && tokens.depth() >= propertyDepth; child = tokens.Next())
+			{
+				if (!child.isOpen())
+				{
+					continue;
+				}
+				auto const childKey{ tokens.Next() };
+				if (childKey.isClose())
+				{
+					continue;
+				}
+				if (childKey.isAtom("at"))
+				{
+					auto const x{ tokens.Next() };
+					auto const y{ x.isValue() ? tokens.Next() : x };
+					if (x.isValue() && y.isValue())
+					{
+						position = QString::fromUtf8(x.text.data(), x.text.size()) + " " + QString::fromUtf8(y.text.data(), y.text.size());
+					}
+					if (y.isClose())
+					{
+						continue;
+					}
+				}
+				tokens.SkipList();
+			}
+			if (!name.isValue() || !value.isValue())
+			{
+				continue;
+			}
+
+			auto& prop{ component.properties.emplace_back() };
+			prop.name = name.toQString();
+			prop.value = value.toQString();
+			prop.offset = token.offset;
+			prop.endOffset = tokens.position();
+			prop.valueOffset = value.offset;
+			prop.valueLength = valueEnd - value.offset;
+			prop.position = std::move(position);
+
+			if (prop.name == "Reference")
+			{
+				component.reference = prop.value;
+			}
+			else if (prop.name == "Value")
+			{
+				component.value = prop.value;
+			}
+			else if (prop.name == "Footprint")
+			{
+				component.footprint = prop.value;
+			}
+		}
+		component.endOffset = tokens.position();
+		symbolEnd = component.endOffset;
+	}
+	return document;
+}
+
+std::shared_ptr<SchematicDocument const> SchematicDocumentCache::Get(QString const& path)
+{
+	QFileInfo const fileData(path);
+	{
+		std::lock_guard<std::mutex> const lock(m_lock);
+		if (auto const found{ m_documents.find(path) }; found != m_documents.end())
+		{
+			if (found->second->fileSize() == fileData.size() && found->second->lastModified() == fileData.lastModified())
+			{
+				return found->second;
+			}
+			m_documents.erase(found);
+		}
+	}
+
+	auto document{ SchematicDocument::Load(path) };
+	if (document)
+	{
+		std::lock_guard<std::mutex> const lock(m_lock);
+		m_documents[path] = document;
+	}
+	return document;
+}
+
+void SchematicDocumentCache::Clear()
+{
+	std::lock_guard<std::mutex> const lock(m_lock);
+	m_documents.clear();
+}
@@ -0,0 +1,92 @@
+#ifndef SCHEMATIC_DOCUMENT_H
+#define SCHEMATIC_DOCUMENT_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+struct SchematicProperty
+{
+	QString name;
+	QString value;
+	std::size_t offset{ 0 };		//'(' of the property
+	std::size_t endOffset{ 0 };		//one past the closing ')'
+	std::size_t valueOffset{ 0 };	//value token, including its quotes
+	std::size_t valueLength{ 0 };
+	QString position;				//"x y" of its (at x y angle)
+};
+
+//Reference of a symbol in one instance of its sheet, "(path "/root/sheet" (reference "R5")"
+struct SymbolInstance
+{
+	QString project;	//empty in the KiCad 6 root symbol_instances
+	QString path;		//KiCad 6: sheet path + "/" + symbol uuid
+	QString reference;
+};
+
+//One placed symbol, "(symbol (lib_id ...)" in a .kicad_sch file
+struct SchematicComponent
+{
+	QString libId;
+	QString reference;
+	QString value;
+	QString footprint;
+	QString uuid;
+	bool onBoard{ true };	//false for "(on_board no)" and "(exclude_from_board)"
+	std::vector<SymbolInstance> instances;	//KiCad 7+, every instance of a sheet used more than once
+	std::vector<SchematicProperty> properties;
+	std::size_t offset{ 0 };
+	std::size_t endOffset{ 0 };
+
+	SchematicProperty const* findProperty(QString const& name) const;
+	QString property(QString const& name) const;
+};
+
+//Component table of a single sheet, parsed in one pass and shared by all the checkers
+class SchematicDocument
+{
+public:
+	static std::shared_ptr<SchematicDocument const> Load(QString const& path);
+	static std::shared_ptr<SchematicDocument const> Parse(QString const& path, std::string_view data);
+
+	QString const& path() const { return m_path; }
+	QString const& fileName() const { return m_fileName; }
+	std::vector<SchematicComponent> const& components() const { return m_components; }
+	//KiCad 6 keeps the instance references of the whole hierarchy in the root sheet
+	std::vector<SymbolInstance> const& symbolInstances() const { return m_symbolInstances; }
+	//sub sheets as written in their "Sheetfile" property
+	QStringList const& sheetFiles() const { return m_sheetFiles; }
+
+	qint64 fileSize() const { return m_fileSize; }
+	QDateTime const& lastModified() const { return m_lastModified; }
+
+private:
+	QString m_path;
+	QString m_fileName;
+	std::vector<SchematicComponent> m_components;
+	std::vector<SymbolInstance> m_symbolInstances;
+	QStringList m_sheetFiles;
+	qint64 m_fileSize{ 0 };
+	QDateTime m_lastModified;
+};
+
+//Keeps parsed sheets until the file changes on disk, so a "check everything" run reads each file once
+//Get may be called from several threads, sheets are parsed outside the lock
+class SchematicDocumentCache
+{
+public:
+	std::shared_ptr<SchematicDocument const> Get(QString const& path);
+	void Clear();
+
+private:
+	std::map<QString, std::shared_ptr<SchematicDocument const>> m_documents;
+	std::mutex m_lock;
+};
+
+#endif
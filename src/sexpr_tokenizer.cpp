@@ -0,0 +1,74 @@
+#include "sexpr_tokenizer.h"
+
+void SexprTokenizer::SkipList()
+{
+	int level{ 1 };
+	while (m_pos < m_data.size())
+	{
+		char const c{ m_data[m_pos] };
+		if (c == '"')
+		{
+			std::size_t const end{ FindStringEnd(m_pos + 1) };
+			m_pos = end < m_data.size() ? end + 1 : end;
+			continue;
+		}
+		++m_pos;
+		if (c == '(')
+		{
+			++level;
+		}
+		else if (c == ')')
+		{
+			if (--level == 0)
+			{
+				--m_depth;
+				return;
+			}
+		}
+	}
+}
+
+QString SexprTokenizer::Decode(std::string_view text)
+{
+	if (text.find('\\') == std::string_view::npos)
+	{
+		return QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()));
+	}
+
+	std::string unescaped;
+	unescaped.reserve(text.size());
+	for (std::size_t i = 0; i < text.size(); ++i)
+	{
+		if (text[i] == '\\' && i + 1 < text.size())
+		{
+			++i;
+			unescaped.push_back(text[i] == 'n' ? '\n' : text[i]);
+			continue;
+		}
+		unescaped.push_back(text[i]);
+	}
+	return QString::fromStdString(unescaped);
+}
+
+QByteArray SexprTokenizer::Encode(QString const& text)
+{
+	QByteArray const utf8{ text.toUtf8() };
+	QByteArray quoted;
+	quoted.reserve(utf8.size() + 2);
+	quoted.append('"');
+	for (char const c : utf8)
+	{
+		if (c == '\n')
+		{
+			quoted.append("\\n");
+			continue;
+		}
+		if (c == '"' || c == '\\')
+		{
+			quoted.append('\\');
+		}
+		quoted.append(c);
+	}
+	quoted.append('"');
+	return quoted;
+}
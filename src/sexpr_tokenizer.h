@@ -0,0 +1,162 @@
+#ifndef SEXPR_TOKENIZER_H
+#define SEXPR_TOKENIZER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <cstring>
+#include <string_view>
+
+//Token view into a KiCad S-expression buffer, text points into the source buffer
+struct SexprToken
+{
+	enum class Type { Open, Close, Atom, String, End };
+
+	Type type{ Type::End };
+	std::string_view text;
+	std::size_t offset{ 0 };
+
+	bool isOpen() const { return type == Type::Open; }
+	bool isClose() const { return type == Type::Close; }
+	bool isEnd() const { return type == Type::End; }
+	bool isValue() const { return type == Type::Atom || type == Type::String; }
+	bool isAtom(std::string_view atom) const { return type == Type::Atom && text == atom; }
+	bool isString(std::string_view str) const { return type == Type::String && text == str; }
+
+	QString toQString() const;
+};
+
+//Zero-copy tokenizer over raw UTF-8 bytes, works regardless of line layout
+class SexprTokenizer
+{
+public:
+	explicit SexprTokenizer(std::string_view data, std::size_t pos = 0) :
+		m_data(data),
+		m_pos(pos)
+	{
+	}
+
+	SexprToken Next()
+	{
+		SkipWhitespace();
+		if (m_pos >= m_data.size())
+		{
+			return { SexprToken::Type::End, {}, m_data.size() };
+		}
+
+		std::size_t const start{ m_pos };
+		char const c{ m_data[m_pos] };
+		if (c == '(')
+		{
+			++m_pos;
+			++m_depth;
+			return { SexprToken::Type::Open, m_data.substr(start, 1), start };
+		}
+		if (c == ')')
+		{
+			++m_pos;
+			--m_depth;
+			return { SexprToken::Type::Close, m_data.substr(start, 1), start };
+		}
+		if (c == '"')
+		{
+			std::size_t const end{ FindStringEnd(start + 1) };
+			m_pos = end < m_data.size() ? end + 1 : end;
+			return { SexprToken::Type::String, m_data.substr(start + 1, end - start - 1), start };
+		}
+		while (m_pos < m_data.size() && !IsDelimiter(m_data[m_pos]))
+		{
+			++m_pos;
+		}
+		return { SexprToken::Type::Atom, m_data.substr(start, m_pos - start), start };
+	}
+
+	SexprToken Peek()
+	{
+		auto const pos{ m_pos };
+		auto const depth{ m_depth };
+		auto const token{ Next() };
+		m_pos = pos;
+		m_depth = depth;
+		return token;
+	}
+
+	//true if the next tokens are "(keyword", does not consume anything
+	bool AtList(std::string_view keyword)
+	{
+		auto const pos{ m_pos };
+		auto const depth{ m_depth };
+		bool const found{ Next().isOpen() && Next().isAtom(keyword) };
+		m_pos = pos;
+		m_depth = depth;
+		return found;
+	}
+
+	//skip to just past the ')' closing the list we are currently in
+	void SkipList();
+
+	void Seek(std::size_t pos) { m_pos = pos; }
+
+	std::size_t position() const { return m_pos; }
+	int depth() const { return m_depth; }
+	std::string_view data() const { return m_data; }
+
+	//decode a string/atom view to QString, handling KiCad backslash escapes
+	static QString Decode(std::string_view text);
+	//quoted UTF-8 string token for text, escaping quotes and backslashes
+	static QByteArray Encode(QString const& text);
+
+private:
+	static bool IsDelimiter(char c)
+	{
+		return c == '(' || c == ')' || c == '"' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_pos < m_data.size())
+		{
+			char const c{ m_data[m_pos] };
+			if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+			{
+				break;
+			}
+			++m_pos;
+		}
+	}
+
+	std::size_t FindStringEnd(std::size_t from) const
+	{
+		while (from < m_data.size())
+		{
+			auto const* quote{ static_cast<char const*>(std::memchr(m_data.data() + from, '"', m_data.size() - from)) };
+			if (quote == nullptr)
+			{
+				return m_data.size();
+			}
+			std::size_t const index{ static_cast<std::size_t>(quote - m_data.data()) };
+			std::size_t slashes{ 0 };
+			while (index > slashes && m_data[index - slashes - 1] == '\\')
+			{
+				++slashes;
+			}
+			if (slashes % 2 == 0)
+			{
+				return index;
+			}
+			from = index + 1;
+		}
+		return m_data.size();
+	}
+
+	std::string_view m_data;
+	std::size_t m_pos{ 0 };
+	int m_depth{ 0 };
+};
+
+inline QString SexprToken::toQString() const
+{
+	return SexprTokenizer::Decode(text);
+}
+
+#endif
@@ -1,13 +1,19 @@
 #include "symbol_finder.h"
 
 #include "kicad_utils.h"
+#include "mapped_file.h"
+#include "schematic_document.h"
+#include "symbol_indexer.h"
 
 #include <QFile>
 #include <QDir>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QSet>
+#include <QHash>
 
+#include <algorithm>
 
 SymbolFinder::SymbolFinder()
 {
@@ -65,131 +71,104 @@ bool SymbolFinder::CheckSchematics()
     rescueSymbolList.clear();
 
     auto const& kicadFiles {directory.entryInfoList(QStringList() << "*.kicad_sch" , QDir::Files)};
-	for (auto const& file : kicadFiles)
-	{
-		emit SendMessage(QString("Checking '%1'").arg(file.fileName()), spdlog::level::level_enum::debug, file.absoluteFilePath());
-		CheckSchematic(file.absoluteFilePath());
-	}
+    for (auto const& report : CheckSheets(kicadFiles, [this](SheetReport& report) { CheckSchematic(report); }))
+    {
+        for (auto const& symbol : report.missing)
+        {
+            if (!missingSymbolList.contains(symbol))
+            {
+                missingSymbolList.append(symbol);
+            }
+        }
+        for (auto const& symbol : report.rescue)
+        {
+            if (!rescueSymbolList.contains(symbol))
+            {
+                rescueSymbolList.append(symbol);
+            }
+        }
+    }
 	return true;
 }
 
-void SymbolFinder::CheckSchematic(QString const& schPath)
+void SymbolFinder::CheckSchematic(SheetReport& report) const
 {
-    QFileInfo fileData(schPath);
-    QFile inFile(schPath);
+    auto const& document{ report.document };
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-	{
-		emit SendMessage(QString("Could not Open '%1'").arg(schPath), spdlog::level::level_enum::warn, schPath);
-		return;
-	}
     bool errorFound{false};
-    bool partSection{false};
-    //int lineCount{0};
-
-    //QString reference;
-    QString symbol;
-	QTextStream in(&inFile);
-	while (!in.atEnd())
-	{
-        //lineCount++;
-		QString line = in.readLine();
-
-        if(line.contains("(symbol (lib_id"))
-		{
-			partSection = true;
-		}
-        if(!partSection)
-		{
-			continue;
-		}
-        QString s = getSchSymbol(line);
-        if(!s.isEmpty())
-        {
-            symbol = s;
-            continue;
-        }
-
-        QString ref = getSchReference( line);
+    for (auto const& component : document->components())
+    {
+        QString const& ref{ component.reference };
+        QString const& symbol{ component.libId };
         if(ref.isEmpty())
         {
            continue;
         }
 
-       
         if(!HasSymbol(symbol))
         {
-            if (!missingSymbolList.contains(symbol))
+            report.missing.append(symbol);
+            report.results.emplace_back(QString("'%1':'%2' was not found in '%3'").arg(ref).arg(symbol).arg(document->fileName()),true);
+            for (auto const& match : symbolMatcher.Find(symbol))
             {
-                missingSymbolList.append(symbol);
+                report.results.emplace_back(QString("'%1' might be '%2'").arg(symbol).arg(match), false);
             }
-            emit SendResult(QString("'%1':'%2' was not found in '%3'").arg(ref).arg(symbol).arg(fileData.fileName()),true);
             errorFound = true;
         }
 
         if(symbol.contains("-rescue"))
         {
-            if (!rescueSymbolList.contains(symbol))
-            {
-                rescueSymbolList.append(symbol);
-            }
-            emit SendResult(QString("'%1':'%2' is a rescue symbol '%3'").arg(ref).arg(symbol).arg(fileData.fileName()),false);
+            report.rescue.append(symbol);
+            report.results.emplace_back(QString("'%1':'%2' is a rescue symbol '%3'").arg(ref).arg(symbol).arg(document->fileName()),false);
             //errorFound = true;
         }
-        symbol.clear();
-	}
-	inFile.close();
+    }
 
     if(!errorFound)
     {
-        emit SendResult(QString("'%1' is Good").arg(fileData.fileName()), false);
+        report.results.emplace_back(QString("'%1' is Good").arg(document->fileName()), false);
     }
 }
 
 bool SymbolFinder::HasSymbol(QString const& symbol) const
 {
-    if(!symbol.contains(":"))
-    {
-        return false;
-    }
-    auto parts {symbol.split(":")};
-
-    if(!SymbolList.contains(parts[0]))
-    {
-        return false;
-    }
-
-    auto const& list = SymbolList.value(parts[0]);
-
-    return list.contains(parts[1]);
+    return symbolIndex.Contains(symbol);
 }
 
 void SymbolFinder::CreateSymbolList()
 {
-    SymbolList.clear();
+    symbolIndex.Clear();
+    symbolMatcher.Clear();
+
+    auto names{ LoadLibraryNames([this](LibraryInfo const& lib) { return GetSymbols(lib.url, lib.type); }) };
+    std::size_t index{ 0 };
+    QSet<QString> nicknames;
 
     for(auto const& [level, library] : libraryList)
     {
         for(auto const& lib : library)
         {
-            if(SymbolList.contains(lib.name))
+            QStringList fps{ std::move(names[index++]) };
+            if(symbolIndex.HasLibrary(lib.name))
             {
                 SendMessage(QString("Duplicate Libraries %1").arg(lib.name), spdlog::level::level_enum::warn, QString());
                 continue;
             }
-            QStringList fps;
-            if(lib.type == LEGACY_LIB)
-            {
-                fps = GetLegacySymbols(lib.url);
-            }
-            else if(lib.type == KICAD_LIB)
+            //missing libraries and later entries of a nickname were skipped by the workers, this reports them as before
+            bool const duplicate{ nicknames.contains(lib.name) };
+            nicknames.insert(lib.name);
+            if(fps.empty() && (duplicate || !QFileInfo::exists(updatePath(lib.url))))
             {
-                fps = GetKicadSymbols(lib.url);
+                fps = GetSymbols(lib.url, lib.type);
             }
 
             if(!fps.empty())
             {
-                SymbolList.insert(lib.name, fps);
+                symbolIndex.AddLibrary(lib.name, fps);
+                for (auto const& name : fps)
+                {
+                    symbolMatcher.Add(lib.name + ":" + name);
+                }
             }
             else 
             {
@@ -197,6 +176,8 @@ void SymbolFinder::CreateSymbolList()
             }
         }
     }
+
+    emit SendMessage(QString("Indexed %1 symbols in %2 libraries (%3 KB)").arg(symbolIndex.itemCount()).arg(symbolIndex.libraryCount()).arg(symbolIndex.memoryUsage() / 1024), spdlog::level::level_enum::debug, QString());
 }
 
 QStringList SymbolFinder::GetLegacySymbols(QString const& url) const
@@ -205,51 +186,22 @@ QStringList SymbolFinder::GetLegacySymbols(QString const& url) const
 
     auto fullPath = updatePath(url);
 
-    //QFileInfo fileData(fullPath);
-    QFile inFile(fullPath);
-
-    if(!inFile.exists())
+    if(!QFile::exists(fullPath))
     {
         emit SendResult(QString("'%1' doesnt' exist").arg(fullPath), true);
         return list;
     }
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-	{
-		return list;
-	}
-
-	QTextStream in(&inFile);
-	while (!in.atEnd())
-	{
-		QString line = in.readLine();
-
-        if(!line.startsWith("DEF"))
-		{
-			continue;
-		}
-
-        auto parts = line.split(" ", Qt::SkipEmptyParts);
-
-        if(parts.count() < 2)
-        {
-            continue;
-        }
-
-        auto name{parts[1]};
-
-        name = kicad_utils::CleanQuotes(name);
-
-        if(name.isEmpty())
-        {
-            continue;
-        }
-
-        list.append(name);
-	}
-	inFile.close();
-
+    auto const library{ m_legacyIndex->Symbols(fullPath) };
+    if (!library)
+    {
+        return list;
+    }
 
+    for (auto const& entry : library->entries())
+    {
+        list.append(entry.name);
+    }
     return list;
 }
 
@@ -259,57 +211,41 @@ QStringList SymbolFinder::GetKicadSymbols(QString const& url) const
 
     auto fullPath = updatePath(url);
 
-    //QFileInfo fileData(fullPath);
-    QFile inFile(fullPath);
-
-    if(!inFile.exists())
+    if(!QFile::exists(fullPath))
     {
         emit SendResult(QString("'%1' doesnt' exist").arg(fullPath), true);
         return list;
     }
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    MappedFile const inFile(fullPath);
+	if (!inFile.isOpen())
 	{
 		return list;
 	}
 
-	QTextStream in(&inFile);
-	while (!in.atEnd())
-	{
-		QString line = in.readLine();
-
-        QString symbol = getLibSymbol( line);
-        if(symbol.isEmpty())
-        {
-            continue;
-        } 
-        if (symbol.contains(":"))
-        {
-            symbol = symbol.split(":")[1];
-        }
-
-        list.append(symbol);
-	}
-	inFile.close();
+    for (auto const& entry : symbol_indexer::Index(inFile.data()))
+    {
+        list.append(entry.name);
+    }
     return list;
 }
 
-bool SymbolFinder::FixSymbols(QString const& libfolder)
+std::vector<LibraryTableChange> SymbolFinder::PlanSymbolFix(QString const& libfolder)
 {
-    bool worked{false};
     /*
         Three Steps of "fixing" footprints
         1) Convert absolute paths to relative paths in Footprint Table
         2) Find librarys in library folder and add Footprint Table
         3) IDK 
     */
-    if (missingSymbolList.empty())
-    {
-        CheckSchematics();
-    }
+
+    //one walk of the library folder serves every lookup below
+    IndexLibraryFolder(libfolder);
+    IndexSymbolLocations(libfolder);
+    std::vector<LibraryTableChange> plan;
 
     //find missing libs
-    for (auto& library : libraryList[PROJECT_LIB])
+    for (auto const& library : libraryList[PROJECT_LIB])
     {
         QString path{ updatePath(library.url) };
         if (QFile::exists(path))
@@ -321,58 +257,74 @@ bool SymbolFinder::FixSymbols(QString const& libfolder)
         QString FoundKicdLibPath = FindRecurseFile(libfolder, QStringList(libraryPath.fileName()));
         if (!FoundKicdLibPath.isEmpty())
         {
-            auto newPath{ ConvertToRelativePath(FoundKicdLibPath,libfolder) };
-            library.url = newPath;
-            worked = true;
+            plan.push_back({ LibraryTableChange::Kind::Relink, library.name, library.type, library.url, ConvertToRelativePath(FoundKicdLibPath, libfolder) });
         }
     }
 
-    if (worked)
+    PlanRelativePaths(libfolder, plan);
+
+    //a relinked library may already hold the symbol, only search for the rest
+    auto const names = [this](QString const& url, QString const& type) { return GetSymbols(url, type); };
+    QHash<QString, QStringList> missingByLibrary;
+    for (auto const& symbol : missingSymbolList)
     {
-        SaveLibraryTable(getProjectLibraryPath());
+        missingByLibrary[symbol.section(':', 0, 0)].append(symbol.section(':', 1));
+    }
+    for (auto const& symbol : missingSymbolList)
+    {
+        LibraryTableChange change;
+        if(!PlanResolves(plan, symbol, names) && AttemptToFindSymbolPath(symbol, libfolder, missingByLibrary.value(symbol.section(':', 0, 0)), change))
+        {
+            plan.push_back(change);
+        }
+    }
 
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
+    ReleaseLibraryFolder();
+    return plan;
+}
+
+std::size_t SymbolFinder::PreviewSymbolFix(QString const& libfolder)
+{
+    if (missingSymbolList.empty())
+    {
         CheckSchematics();
     }
-    worked = false;
-
-    if(ConvertAllPathsToRelative(libfolder))
+    auto const plan{ PlanSymbolFix(libfolder) };
+    for (auto const& change : plan)
     {
-        SaveLibraryTable(getProjectLibraryPath());
+        emit SendResult(change.asString(), false);
+    }
+    emit SendResult(QString("Preview: %1 symbol library table changes").arg(plan.size()), false);
+    return plan.size();
+}
 
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
+bool SymbolFinder::FixSymbols(QString const& libfolder)
+{
+    if (missingSymbolList.empty())
+    {
         CheckSchematics();
     }
 
-    for (auto const& footprint : missingSymbolList)
+    //every table change is planned first, then written once and checked once
+    auto const plan{ PlanSymbolFix(libfolder) };
+    //symbol names read while planning are kept for the next run
+    m_libraryIndex->Save();
+    for (auto const& change : plan)
     {
-        if(AttemptToFindSymbolPath(footprint, libfolder))
-        {
-            worked = true;
-        }
+        emit SendMessage(change.asString(), spdlog::level::level_enum::info, QString());
     }
 
-    if(worked)
+    if (!ApplyPlan(plan))
     {
-        SaveLibraryTable(getProjectLibraryPath());
-
-        emit SendClearLibrary(PROJECT_LIB);
-        libraryList[PROJECT_LIB].clear();
-        getProjectLibraries();
-        emit SendClearResults();
-        CheckSchematics();
+        return false;
     }
-
-    return worked;
+    //unchanged libraries come from the name cache, only the missing symbols of changed ones are looked up again
+    CreateSymbolList();
+    RecheckMissing(plan, missingSymbolList, [this](QString const& symbol) { return HasSymbol(symbol); });
+    return true;
 }
 
-bool SymbolFinder::AttemptToFindSymbolPath(QString const& footprint, QString const& libraryPath )
+bool SymbolFinder::AttemptToFindSymbolPath(QString const& footprint, QString const& libraryPath, QStringList const& missing, LibraryTableChange& change) const
 {
     if(!footprint.contains(":"))
     {
@@ -380,92 +332,95 @@ bool SymbolFinder::AttemptToFindSymbolPath(QString const& footprint, QString con
     }
     auto parts {footprint.split(":")};
 
-    QString const LibName{parts[0]};
-
-    QString const Kicd6SymbolName{LibName + ".kicad_sym"};
-
-    QString const LibNameFolder{libraryPath + "/"+ LibName};
+    //one lookup, works even when the library file was renamed
+    auto const candidates{ symbolLocations.Find(parts[0], parts[1]) };
+    if(candidates.isEmpty())
+    {
+        return false;
+    }
 
+    //"R" or "GND" live in many vendor libraries, a file unrelated to the nickname is only trusted
+    //when it is the one file holding every missing symbol of that nickname
     QString FoundKicdLibPath;
-
-    //first look for libraries in foldse the same as the library name
-    QDir libdir(LibNameFolder);
-    if(libdir.exists())
+    if (SymbolLocationIndex::Score(parts[0], candidates.first()) >= SymbolLocationIndex::MIN_SCORE)
     {
-        FoundKicdLibPath = FindRecurseFile(LibNameFolder, QStringList(Kicd6SymbolName));
-        if(!FoundKicdLibPath.isEmpty())
+        FoundKicdLibPath = candidates.first();
+    }
+    else
+    {
+        QStringList complete;
+        for (auto const& candidate : candidates)
         {
-            auto symbols = GetKicadSymbols(FoundKicdLibPath);
-            if(symbols.contains(parts[1]))
+            if (std::all_of(missing.begin(), missing.end(), [&](QString const& name) { return symbolLocations.Contains(candidate, name); }))
             {
-                //found something
-                //convert to relative path
-                //add to library file
-
-                auto newPath{ConvertToRelativePath(FoundKicdLibPath,libraryPath )};
-
-                emit SendMessage(QString("Found '%1' symbol in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-                AddLibraryPath(parts[0], KICAD_LIB, newPath, PROJECT_LIB);
-                return true;
+                complete.append(candidate);
             }
         }
-
-        FoundKicdLibPath = FindRecurseFile(LibNameFolder, {"*.lib"});
-        if(!FoundKicdLibPath.isEmpty())
+        if (complete.size() != 1)
         {
-            //legacy
-            auto Footprints = GetLegacySymbols(FoundKicdLibPath);
-            if(Footprints.contains(parts[1]))
+            for (auto const& candidate : candidates)
             {
-                //found something
-                //convert to relative path
-                //add to library file
-                auto newPath{ConvertToRelativePath(FoundKicdLibPath,libraryPath)};
-                emit SendMessage(QString("Found '%1' footprint in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-                AddLibraryPath(parts[0], LEGACY_LIB, newPath,PROJECT_LIB);
-                return true;
+                emit SendResult(QString("'%1' might be in '%2'").arg(footprint).arg(candidate), false);
             }
+            return false;
         }
+        FoundKicdLibPath = complete.first();
     }
 
-    FoundKicdLibPath = FindRecurseFile(libraryPath, QStringList(Kicd6SymbolName));
-
-    if(!FoundKicdLibPath.isEmpty())
+    for (auto const& candidate : candidates)
     {
-        auto symbols = GetKicadSymbols(FoundKicdLibPath);
-        if(symbols.contains(parts[1]))
+        if (candidate != FoundKicdLibPath)
         {
-            //found something
-            //convert to relative path
-            //add to library file
+            emit SendMessage(QString("'%1' is also in '%2'").arg(footprint).arg(candidate), spdlog::level::level_enum::debug, candidate);
+        }
+    }
 
-            auto newPath{ConvertToRelativePath(FoundKicdLibPath, libraryPath)};
+    QString const type{ QFileInfo(FoundKicdLibPath).suffix().toLower() == "lib" ? LEGACY_LIB : KICAD_LIB };
 
-            emit SendMessage(QString("Found '%1' symbol in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-            AddLibraryPath(parts[0], KICAD_LIB, newPath, PROJECT_LIB);
-            return true;
+    //convert to relative path
+    //add to library file
+    auto newPath{ConvertToRelativePath(FoundKicdLibPath, libraryPath)};
+
+    emit SendMessage(QString("Found '%1' symbol in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
+    change = PlanLibrary(parts[0], type, newPath);
+    return true;
+}
+
+void SymbolFinder::IndexSymbolLocations(QString const& libfolder)
+{
+    symbolLocations.Clear();
+
+    auto const files{ FindRecurseFiles(libfolder, { "*.kicad_sym", "*.lib" }) };
+    std::vector<QStringList> names(static_cast<std::size_t>(files.size()));
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        if (!m_libraryIndex->Find(files[static_cast<qsizetype>(i)], names[i]))
+        {
+            pending.push_back(i);
         }
     }
 
-    QStringList const KicdLegacyLibName{LibName + ".lib", parts[1]+ ".lib", LibName + "*.lib", parts[1]+ "*.lib"};
-    FoundKicdLibPath = FindRecurseFile(libraryPath, KicdLegacyLibName);
-    if(!FoundKicdLibPath.isEmpty())
+    RunParallel(pending.size(), [&](std::size_t job)
     {
-        //legacy
-        auto Footprints = GetLegacySymbols(FoundKicdLibPath);
-        if(Footprints.contains(parts[1]))
+        QString const& path{ files[static_cast<qsizetype>(pending[job])] };
+        names[pending[job]] = QFileInfo(path).suffix().toLower() == "lib" ? GetLegacySymbols(path) : GetKicadSymbols(path);
+    });
+
+    for (auto const index : pending)
+    {
+        if (!names[index].empty())
         {
-            //found something
-            //convert to relative path
-            //add to library file
-            auto newPath{ConvertToRelativePath(FoundKicdLibPath,libraryPath)};
-            emit SendMessage(QString("Found '%1' symbol in '%2'").arg(footprint).arg(newPath), spdlog::level::level_enum::debug, FoundKicdLibPath);
-            AddLibraryPath(parts[0], LEGACY_LIB, newPath,PROJECT_LIB);
-            return true;
+            m_libraryIndex->Store(files[static_cast<qsizetype>(index)], names[index]);
         }
     }
-    
-    return false;
+
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        symbolLocations.AddLibrary(files[static_cast<qsizetype>(i)], names[i]);
+    }
+
+    emit SendMessage(QString("Indexed %1 symbols in %2 library files").arg(symbolLocations.symbolCount()).arg(symbolLocations.libraryCount()), spdlog::level::level_enum::debug, libfolder);
 }
 
 QStringList SymbolFinder::GetSymbols(QString const& url, QString const& type) const 
@@ -481,6 +436,35 @@ QStringList SymbolFinder::GetSymbols(QString const& url, QString const& type) co
     return QStringList();
 }
 
+std::size_t SymbolFinder::FindDuplicateSymbols()
+{
+    //a library listed in both tables is only read once
+    QSet<QString> seen;
+    std::vector<DuplicateSource> sources;
+    for(auto const& [level,library] : libraryList)
+    {
+        for(auto const& lib : library)
+        {
+            auto const fullPath{ updatePath(lib.url) };
+            if(!QFileInfo::exists(fullPath) || seen.contains(fullPath))
+            {
+                continue;
+            }
+            seen.insert(fullPath);
+
+            if (lib.type == LEGACY_LIB)
+            {
+                sources.push_back({ lib.name, fullPath, LibraryItemFormat::LegacySymbols });
+            }
+            else if (lib.type == KICAD_LIB)
+            {
+                sources.push_back({ lib.name, fullPath, LibraryItemFormat::KicadSymbols });
+            }
+        }
+    }
+    return ReportDuplicates(sources, "symbol");
+}
+
 LibraryInfo SymbolFinder::DecodeLibraryInfo(QString const& path, QString const& libFolder) const
 {
     LibraryInfo info;
@@ -4,6 +4,9 @@
 #include "library_info.h"
 
 #include "library_base.h"
+#include "library_index.h"
+#include "name_matcher.h"
+#include "symbol_location_index.h"
 
 #include <QObject>
 #include <QMap>
@@ -18,8 +21,14 @@ public:
 
 	bool CheckSchematics();
 	bool FixSymbols(QString const& libfolder);
+	//the table changes FixSymbols would make, reported as results, nothing is written
+	std::size_t PreviewSymbolFix(QString const& libfolder);
+	//the table changes for the symbols the last CheckSchematics found missing
+	std::vector<LibraryTableChange> PlanSymbolFix(QString const& libfolder);
 
 	QStringList GetSymbols(QString const& url, QString const& type) const;
+	//reports symbols of the project and global tables that only differ by name or timestamps
+	std::size_t FindDuplicateSymbols();
 
 Q_SIGNALS:
 
@@ -32,7 +41,7 @@ private:
 
 	LibraryInfo DecodeLibraryInfo(QString const& path, QString const& libFolder) const override;
 
-	void CheckSchematic(QString const& schPath);
+	void CheckSchematic(SheetReport& report) const;
 	void CreateSymbolList();
 
 	bool HasSymbol(QString const& footprint) const;
@@ -40,9 +49,13 @@ private:
 
 	QStringList GetKicadSymbols(QString const& url) const;
 
-	bool AttemptToFindSymbolPath(QString const& footprint, QString const& libraryPath );
+	void IndexSymbolLocations(QString const& libfolder);
+	//missing lists every missing symbol name of the nickname, an unrelated file is only used if it alone holds them all
+	bool AttemptToFindSymbolPath(QString const& footprint, QString const& libraryPath, QStringList const& missing, LibraryTableChange& change) const;
 
-	QMap<QString,QStringList> SymbolList;
+	LibraryIndex symbolIndex;
+	NameMatcher symbolMatcher;
+	SymbolLocationIndex symbolLocations;
 
 	QStringList missingSymbolList;
 	QStringList rescueSymbolList;
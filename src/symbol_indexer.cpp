@@ -0,0 +1,67 @@
+#include "symbol_indexer.h"
+
+#include "sexpr_tokenizer.h"
+
+#include <QFile>
+
+namespace symbol_indexer
+{
+	std::vector<SymbolIndexEntry> Index(std::string_view data)
+	{
+		std::vector<SymbolIndexEntry> entries;
+
+		SexprTokenizer tokens(data);
+		if (!tokens.Next().isOpen() || !tokens.Next().isAtom("kicad_symbol_lib"))
+		{
+			return entries;
+		}
+
+		//only look at the direct children of "(kicad_symbol_lib", every body is skipped by paren depth
+		for (auto token{ tokens.Next() }; !token.isEnd() && !token.isClose(); token = tokens.Next())
+		{
+			if (!token.isOpen())
+			{
+				continue;
+			}
+			auto const key{ tokens.Next() };
+			if (key.isClose())
+			{
+				continue;
+			}
+			if (!key.isAtom("symbol"))
+			{
+				tokens.SkipList();
+				continue;
+			}
+
+			auto const name{ tokens.Next() };
+			if (name.isClose())
+			{
+				continue;
+			}
+			tokens.SkipList();
+			if (!name.isValue() || name.text.empty())
+			{
+				continue;
+			}
+
+			QString symbol{ name.toQString() };
+			if (symbol.contains(":"))
+			{
+				symbol = symbol.split(":")[1];
+			}
+			entries.push_back({ std::move(symbol), token.offset, tokens.position() - token.offset });
+		}
+		return entries;
+	}
+
+	QByteArray ReadSymbol(QString const& path, SymbolIndexEntry const& entry)
+	{
+		QFile inFile(path);
+		if (!inFile.open(QIODevice::ReadOnly) || !inFile.seek(static_cast<qint64>(entry.offset)))
+		{
+			return QByteArray();
+		}
+		return inFile.read(static_cast<qint64>(entry.length));
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef SYMBOL_INDEXER_H
+#define SYMBOL_INDEXER_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <string_view>
+#include <vector>
+
+//One top-level "(symbol" of a .kicad_sym library, offset/length cover the whole list
+struct SymbolIndexEntry
+{
+	QString name;
+	std::size_t offset{ 0 };
+	std::size_t length{ 0 };
+};
+
+namespace symbol_indexer
+{
+	//top-level symbols only, unit sub-symbols like "R_0_1" are skipped with the body
+	std::vector<SymbolIndexEntry> Index(std::string_view data);
+
+	//raw "(symbol ...)" text of one entry, read straight from its offset
+	QByteArray ReadSymbol(QString const& path, SymbolIndexEntry const& entry);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include "symbol_location_index.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <vector>
+
+void SymbolLocationIndex::AddLibrary(QString const& path, QStringList const& symbols)
+{
+	for (auto const& symbol : symbols)
+	{
+		m_locations[symbol].append(path);
+	}
+	++m_libraries;
+}
+
+int SymbolLocationIndex::Score(QString const& library, QString const& path)
+{
+	//same file name as the nickname beats a folder of that name, KiCad 6 files beat legacy ones
+	QFileInfo const file(path);
+	int value{ 0 };
+	if (file.completeBaseName() == library)
+	{
+		value += 8;
+	}
+	else if (file.completeBaseName().compare(library, Qt::CaseInsensitive) == 0)
+	{
+		value += 6;
+	}
+	else if (file.completeBaseName().contains(library, Qt::CaseInsensitive))
+	{
+		value += 2;
+	}
+	if (path.contains("/" + library + "/"))
+	{
+		value += 4;
+	}
+	if (file.suffix().compare("kicad_sym", Qt::CaseInsensitive) == 0)
+	{
+		value += 1;
+	}
+	return value;
+}
+
+bool SymbolLocationIndex::Contains(QString const& path, QString const& symbol) const
+{
+	auto const found{ m_locations.find(symbol) };
+	return found != m_locations.end() && found.value().contains(path);
+}
+
+QStringList SymbolLocationIndex::Find(QString const& library, QString const& symbol) const
+{
+	auto const found{ m_locations.find(symbol) };
+	if (found == m_locations.end())
+	{
+		return QStringList();
+	}
+
+	std::vector<std::pair<int, QString>> ranked;
+	for (auto const& path : found.value())
+	{
+		ranked.emplace_back(Score(library, path), path);
+	}
+	//stable so equal scores keep the folder walk order
+	std::stable_sort(ranked.begin(), ranked.end(), [](auto const& lhs, auto const& rhs) { return lhs.first > rhs.first; });
+
+	QStringList files;
+	for (auto const& [value, path] : ranked)
+	{
+		files.append(path);
+	}
+	return files;
+}
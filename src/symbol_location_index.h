@@ -0,0 +1,34 @@
+#ifndef SYMBOL_LOCATION_INDEX_H
+#define SYMBOL_LOCATION_INDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+//Reverse index of a library folder, symbol name -> every .kicad_sym/.lib file that defines it
+class SymbolLocationIndex
+{
+public:
+	void Clear() { m_locations.clear(); m_libraries = 0; }
+	void AddLibrary(QString const& path, QStringList const& symbols);
+
+	//files defining symbol, ranked so the one most likely meant by library comes first
+	QStringList Find(QString const& library, QString const& symbol) const;
+	//true when the file at path defines symbol
+	bool Contains(QString const& path, QString const& symbol) const;
+
+	//how well the file name and folders of path match the nickname library
+	//below MIN_SCORE neither the file name nor a folder is the nickname, a name merely containing it ("R" in "Relay") is not enough
+	static int Score(QString const& library, QString const& path);
+	static constexpr int MIN_SCORE = 4;
+
+	bool empty() const { return m_locations.isEmpty(); }
+	qsizetype symbolCount() const { return m_locations.size(); }
+	qsizetype libraryCount() const { return m_libraries; }
+
+private:
+	QHash<QString, QStringList> m_locations;
+	qsizetype m_libraries{ 0 };
+};
+
+#endif
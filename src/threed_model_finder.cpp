@@ -1,12 +1,24 @@
 #include "threed_model_finder.h"
 
-#include "kicad_utils.h"
+#include "file_patch.h"
+#include "footprint_consistency.h"
+#include "mapped_file.h"
+#include "model_weight.h"
+#include "marker_scanner.h"
+#include "sexpr_tokenizer.h"
 
 #include <QFile>
+#include <QSaveFile>
 #include <QDir>
-#include <QTextStream>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSet>
+
+#include <algorithm>
+
+//the variable model paths are written with, KISYS3DMOD is updated to it as well
+constexpr const char* MODEL_DIR_VAR = "KICAD6_3DMODEL_DIR";
 
 ThreeDModelFinder::ThreeDModelFinder()
 {
@@ -15,6 +27,7 @@ ThreeDModelFinder::ThreeDModelFinder()
 void ThreeDModelFinder::LoadProject(QString const& folder)
 {
 	m_projectFolder = folder;
+	m_paths->SetProject(folder);
 }
 
 bool ThreeDModelFinder::CheckPCBs()
@@ -29,242 +42,565 @@ bool ThreeDModelFinder::CheckPCBs()
 	incorrectThreeDModelFileList.clear();
 
 	auto const& kicadFiles{ directory.entryInfoList(QStringList() << "*.kicad_pcb" , QDir::Files) };
-	for (auto const& file : kicadFiles)
+	auto const boards{ LoadBoards(kicadFiles) };
+	StatModels(boards);
+
+	for (qsizetype i = 0; i < kicadFiles.size(); ++i)
 	{
+		auto const& file{ kicadFiles[i] };
 		emit SendMessage(QString("Checking '%1'").arg(file.fileName()), spdlog::level::level_enum::debug, file.absoluteFilePath());
-		CheckPCB(file.absoluteFilePath());
+		auto const& board{ boards[static_cast<std::size_t>(i)] };
+		if (!board)
+		{
+			emit SendMessage(QString("Could not Open '%1'").arg(file.absoluteFilePath()), spdlog::level::level_enum::warn, file.absoluteFilePath());
+			continue;
+		}
+		CheckPCB(*board);
 	}
 	return true;
 }
 
-void ThreeDModelFinder::CheckPCB(QString const& pcbPath)
+std::vector<std::shared_ptr<BoardDocument const>> ThreeDModelFinder::LoadBoards(QFileInfoList const& files) const
 {
-	QFileInfo fileData(pcbPath);
-	QFile inFile(pcbPath);
+	std::vector<std::shared_ptr<BoardDocument const>> boards(static_cast<std::size_t>(files.size()));
+	RunParallel(boards.size(), [&](std::size_t index)
+	{
+		boards[index] = BoardDocument::Load(files[static_cast<qsizetype>(index)].absoluteFilePath());
+	});
+	return boards;
+}
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+std::vector<std::shared_ptr<SchematicDocument const>> ThreeDModelFinder::LoadSheets(QDir const& directory, QString const& project) const
+{
+	QStringList level;
+	if (QString const root{ directory.absoluteFilePath(project + ".kicad_sch") }; !project.isEmpty() && QFileInfo::exists(root))
 	{
-		emit SendMessage(QString("Could not Open '%1'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
-		return;
+		level.append(QDir::cleanPath(root));
 	}
-	bool errorFound{ false };
-	//bool partSection{false};
-	//int lineCount{0};
-
-	QString reference;
-	QTextStream in(&inFile);
-	while (!in.atEnd())
+	else
 	{
-		//lineCount++;
-		QString const line = in.readLine();
-
-		QString const ref = getPCBReference(line);
-		if (!ref.isEmpty())
+		for (auto const& file : directory.entryInfoList(QStringList() << "*.kicad_sch", QDir::Files))
 		{
-			reference = ref;
+			level.append(file.absoluteFilePath());
 		}
+	}
 
-		QString const model = getThreeDModelPath(line);
-		if (model.isEmpty())
+	std::vector<std::shared_ptr<SchematicDocument const>> sheets;
+	QSet<QString> loaded(level.cbegin(), level.cend());
+	while (!level.isEmpty())
+	{
+		std::vector<std::shared_ptr<SchematicDocument const>> documents(static_cast<std::size_t>(level.size()));
+		RunParallel(documents.size(), [&](std::size_t index)
 		{
-			continue;
+			documents[index] = m_documents->Get(level[static_cast<qsizetype>(index)]);
+		});
+
+		//sheet files are relative to the sheet that uses them, older projects have them relative to the project
+		QStringList next;
+		for (auto const& document : documents)
+		{
+			if (!document)
+			{
+				continue;
+			}
+			QDir const folder{ QFileInfo(document->path()).absoluteDir() };
+			for (auto const& sheetFile : document->sheetFiles())
+			{
+				QString path{ QDir::cleanPath(folder.absoluteFilePath(sheetFile)) };
+				if (!QFileInfo::exists(path))
+				{
+					path = QDir::cleanPath(directory.absoluteFilePath(sheetFile));
+				}
+				if (!loaded.contains(path))
+				{
+					loaded.insert(path);
+					next.append(path);
+				}
+			}
+			sheets.push_back(document);
 		}
-		//auto fullPath = updatePath(model);
-		if (!model.startsWith("$") || model.startsWith("${KISYS3DMOD}"))
+		level = std::move(next);
+	}
+	return sheets;
+}
+
+void ThreeDModelFinder::CheckPCB(BoardDocument const& board)
+{
+	bool errorFound{ false };
+	for (auto const& footprint : board.footprints())
+	{
+		for (auto const& model : footprint.models)
 		{
-			if (!incorrectThreeDModelFileList.contains(pcbPath))
+			if (!model.startsWith("$") || model.startsWith("${KISYS3DMOD}"))
+			{
+				if (!incorrectThreeDModelFileList.contains(board.path()))
+				{
+					incorrectThreeDModelFileList.append(board.path());
+				}
+				emit SendResult(QString("'%1':'%2' has incorrect path in '%3'").arg(footprint.reference).arg(model).arg(board.fileName()), true);
+				errorFound = true;
+			}
+			if (!ModelExists(model))
 			{
-				incorrectThreeDModelFileList.append(pcbPath);
+				if (!incorrectThreeDModelFileList.contains(board.path()))
+				{
+					incorrectThreeDModelFileList.append(board.path());
+				}
+				emit SendResult(QString("'%1':'%2' model file not found in '%3'").arg(footprint.reference).arg(model).arg(board.fileName()), true);
+				errorFound = true;
 			}
-			emit SendResult(QString("'%1':'%2' has incorrect path in '%3'").arg(reference).arg(model).arg(fileData.fileName()), true);
-			errorFound = true;
 		}
-		//reference.clear();
 	}
-	inFile.close();
 
 	if (!errorFound)
 	{
-		emit SendResult(QString("'%1' is Good").arg(fileData.fileName()), false);
+		emit SendResult(QString("'%1' is Good").arg(board.fileName()), false);
 	}
 }
 
-
-bool ThreeDModelFinder::FixThreeDModels(QString const& folder)
+bool ThreeDModelFinder::CompareSchematics()
 {
-	bool worked{ false };
-	/*
-		Three Steps of "fixing" footprints
-		1) Convert absolute paths to relative paths in Footprint Table
-		2) Find librarys in library folder and add Footprint Table
-		3) IDK
-	*/
-	if (incorrectThreeDModelFileList.empty())
+	QDir directory(m_projectFolder);
+	if (!directory.exists())
 	{
-		CheckPCBs();
+		emit SendMessage("Directory Doesn't Exist", spdlog::level::level_enum::warn, QString());
+		return false;
 	}
 
-	//if(ConvertAllPathsToRelative(folder))
-	//{
-	//    emit SendClearResults();
-	//    CheckPCBs();
-	//}
+	QElapsedTimer timer;
+	timer.start();
 
-	for (auto const& filePath : incorrectThreeDModelFileList)
+	auto const projectFiles{ directory.entryInfoList(QStringList() << "*.kicad_pro", QDir::Files) };
+	QString const project{ projectFiles.isEmpty() ? QString() : projectFiles.first().completeBaseName() };
+	auto const sheets{ LoadSheets(directory, project) };
+
+	auto const boardFiles{ directory.entryInfoList(QStringList() << "*.kicad_pcb", QDir::Files) };
+	auto const boards{ LoadBoards(boardFiles) };
+	for (qsizetype i = 0; i < boardFiles.size(); ++i)
 	{
-		if (AttemptToFixThreeDModelFile(filePath, folder))
+		auto const& file{ boardFiles[i] };
+		emit SendMessage(QString("Comparing '%1'").arg(file.fileName()), spdlog::level::level_enum::debug, file.absoluteFilePath());
+		auto const& board{ boards[static_cast<std::size_t>(i)] };
+		if (!board)
 		{
-			worked = true;
-			emit SendMessage(QString("Fixed '%1'").arg(filePath), spdlog::level::level_enum::debug, filePath);
+			emit SendMessage(QString("Could not Open '%1'").arg(file.absoluteFilePath()), spdlog::level::level_enum::warn, file.absoluteFilePath());
+			continue;
+		}
+
+		auto const mismatches{ footprint_consistency::Compare(sheets, *board, project) };
+		for (auto const& mismatch : mismatches)
+		{
+			emit SendResult(mismatch.asString(), true);
+		}
+		if (mismatches.empty())
+		{
+			emit SendResult(QString("'%1' matches the schematic").arg(file.fileName()), false);
 		}
 	}
-	if (worked)
+	emit SendMessage(QString("Compared %1 sheets with %2 boards in %3 ms").arg(sheets.size()).arg(boards.size()).arg(timer.elapsed()), spdlog::level::level_enum::debug, QString());
+	return true;
+}
+
+QString ThreeDModelFinder::ResolveModel(QString const& model) const
+{
+	auto const path{ updatePath(model) };
+	if (QDir::isRelativePath(path))
 	{
-		//QString localLibPath {m_projectFolder + "/fp-lib-table"};
-		emit SendClearResults();
-		CheckPCBs();
+		return QDir::cleanPath(m_projectFolder + "/" + path);
 	}
+	return QDir::cleanPath(path);
+}
 
-	return worked;
+QStringList ThreeDModelFinder::ModelCandidates(QString const& resolved)
+{
+	QStringList candidates{ resolved };
+	QString const suffix{ QFileInfo(resolved).suffix().toLower() };
+	static QStringList const formats{ "wrl", "wrz", "step", "stp" };
+	if (!formats.contains(suffix))
+	{
+		return candidates;
+	}
+	QString const base{ resolved.left(resolved.size() - suffix.size()) };
+	for (auto const& format : formats)
+	{
+		if (format != suffix)
+		{
+			candidates.append(base + format);
+		}
+	}
+	return candidates;
 }
 
-bool ThreeDModelFinder::AttemptToFixThreeDModelFile(QString const& pcbPath, QString const& libraryPath)
+void ThreeDModelFinder::StatModels(std::vector<std::shared_ptr<BoardDocument const>> const& boards)
 {
-	std::vector<QString> lines;
-	std::vector<QString> newlines;
+	modelFiles.clear();
 
-	QFile inFile(pcbPath);
+	//2000 footprints usually share a few hundred models, each file is only looked at once
+	std::size_t references{ 0 };
+	QSet<QString> unique;
+	for (auto const& board : boards)
+	{
+		if (!board)
+		{
+			continue;
+		}
+		for (auto const& footprint : board->footprints())
+		{
+			for (auto const& model : footprint.models)
+			{
+				for (auto const& candidate : ModelCandidates(ResolveModel(model)))
+				{
+					unique.insert(candidate);
+				}
+				++references;
+			}
+		}
+	}
 
-	if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	QStringList const paths{ unique.values() };
+	std::vector<char> exists(static_cast<std::size_t>(paths.size()), 0);
+	RunParallel(exists.size(), [&](std::size_t index)
 	{
-		emit SendMessage(QString("Could not Open '%1'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
-		return false;
+		exists[index] = QFileInfo::exists(paths[static_cast<qsizetype>(index)]) ? 1 : 0;
+	});
+
+	modelFiles.reserve(paths.size());
+	for (qsizetype i = 0; i < paths.size(); ++i)
+	{
+		modelFiles.insert(paths[i], exists[static_cast<std::size_t>(i)] != 0);
+	}
+	emit SendMessage(QString("Checked %1 model files for %2 model references").arg(paths.size()).arg(references), spdlog::level::level_enum::debug, QString());
+}
+
+bool ThreeDModelFinder::ModelExists(QString const& model) const
+{
+	for (auto const& candidate : ModelCandidates(ResolveModel(model)))
+	{
+		//paths that weren't part of the last check are looked at directly
+		auto const found{ modelFiles.constFind(candidate) };
+		if (found != modelFiles.constEnd() ? found.value() : QFileInfo::exists(candidate))
+		{
+			return true;
+		}
 	}
-	QTextStream in(&inFile);
-	while (!in.atEnd())
+	return false;
+}
+
+QString ThreeDModelFinder::ExistingModel(QString const& model) const
+{
+	for (auto const& candidate : ModelCandidates(ResolveModel(model)))
 	{
-		lines.emplace_back(in.readLine());
+		if (QFileInfo::exists(candidate))
+		{
+			return candidate;
+		}
 	}
-	inFile.close();
-	std::map<QString, QString> convertList;
-	QString reference;
+	return QString();
+}
 
-	for (auto const& line : lines)
+bool ThreeDModelFinder::AuditModelWeights(QString const& libraryPath)
+{
+	QDir directory(m_projectFolder);
+	if (!directory.exists())
 	{
-		QString outLine = line;
+		emit SendMessage("Directory Doesn't Exist", spdlog::level::level_enum::warn, QString());
+		return false;
+	}
+
+	auto const boardFiles{ directory.entryInfoList(QStringList() << "*.kicad_pcb", QDir::Files) };
+	auto const boards{ LoadBoards(boardFiles) };
+	modelIndexChecked = false;
 
-		QString const ref = getPCBReference(line);
-		if (!ref.isEmpty())
+	//every footprint using a model shares one measurement of its file
+	QHash<QString, QString> files;	//model path as written -> file on disk
+	QSet<QString> unique;
+	for (auto const& board : boards)
+	{
+		if (!board)
 		{
-			reference = ref;
+			continue;
+		}
+		for (auto const& footprint : board->footprints())
+		{
+			for (auto const& model : footprint.models)
+			{
+				if (!files.contains(model))
+				{
+					QString const file{ ExistingModel(model) };
+					files.insert(model, file);
+					if (!file.isEmpty())
+					{
+						unique.insert(file);
+					}
+				}
+			}
 		}
+	}
 
-		QString model = getThreeDModelPath(line);
+	QStringList const paths{ unique.values() };
+	std::vector<ModelWeight> weights(static_cast<std::size_t>(paths.size()));
+	RunParallel(weights.size(), [&](std::size_t index)
+	{
+		weights[index] = model_weight::Measure(paths[static_cast<qsizetype>(index)]);
+	});
+	QHash<QString, ModelWeight> measured;
+	for (qsizetype i = 0; i < paths.size(); ++i)
+	{
+		measured.insert(paths[i], weights[static_cast<std::size_t>(i)]);
+	}
 
-		if (!model.isEmpty() && model.startsWith("${KISYS3DMOD}"))
+	constexpr std::size_t MAX_REPORTED{ 10 };
+	for (qsizetype i = 0; i < boardFiles.size(); ++i)
+	{
+		auto const& board{ boards[static_cast<std::size_t>(i)] };
+		if (!board)
 		{
-			outLine = outLine.replace("${KISYS3DMOD}", "${KICAD6_3DMODEL_DIR}");
-			emit SendMessage("Updating '${KISYS3DMOD}' to '${KICAD6_3DMODEL_DIR}'", spdlog::level::level_enum::debug, QString());
+			emit SendMessage(QString("Could not Open '%1'").arg(boardFiles[i].absoluteFilePath()), spdlog::level::level_enum::warn, boardFiles[i].absoluteFilePath());
+			continue;
 		}
 
-		if (!model.isEmpty() && !model.startsWith("$"))
+		QHash<QString, int> uses;
+		for (auto const& footprint : board->footprints())
 		{
-			if (convertList.contains(model))
+			for (auto const& model : footprint.models)
 			{
-				outLine = outLine.replace(model, convertList.at(model));
-				emit SendMessage(QString("Updating '%1' to '%2'").arg(model).arg(convertList.at(model)), spdlog::level::level_enum::debug, QString());
+				if (QString const file{ files.value(model) }; !file.isEmpty())
+				{
+					++uses[file];
+				}
 			}
-			else
+		}
+
+		std::vector<QString> heaviest(uses.keyBegin(), uses.keyEnd());
+		std::sort(heaviest.begin(), heaviest.end(), [&](QString const& lhs, QString const& rhs) { return measured[lhs].bytes > measured[rhs].bytes; });
+
+		qint64 total{ 0 };
+		for (auto const& file : heaviest)
+		{
+			total += measured[file].bytes;
+		}
+		emit SendResult(QString("'%1' loads %2 model files, %3 MB").arg(board->fileName()).arg(heaviest.size()).arg(static_cast<double>(total) / (1024.0 * 1024.0), 0, 'f', 1), false);
+
+		heaviest.resize(std::min(heaviest.size(), MAX_REPORTED));
+		for (auto const& file : heaviest)
+		{
+			auto const& weight{ measured[file] };
+			emit SendResult(QString("'%1' %2, used %3 times").arg(file).arg(weight.asString()).arg(uses[file]), false);
+
+			//the smallest file with the same name, a .wrl next to a STEP or a simplified copy in the library
+			QString lighter;
+			qint64 lighterBytes{ weight.bytes };
+			EnsureModelIndex(libraryPath);
+			for (auto const& match : modelIndex.Matches(file))
 			{
-				auto const newPath = ConvertToRelativePath(model, libraryPath);
-				if (!newPath.isEmpty() && newPath != model)
+				qint64 const bytes{ QFileInfo(match).size() };
+				if (match != file && bytes > 0 && bytes < lighterBytes)
 				{
-					convertList.insert({ model, newPath });
-					outLine = outLine.replace(model, newPath);
-					emit SendMessage(QString("Updating '%1' to '%2'").arg(model).arg(newPath), spdlog::level::level_enum::debug, QString());
+					lighter = match;
+					lighterBytes = bytes;
 				}
 			}
+			if (!lighter.isEmpty())
+			{
+				emit SendResult(QString("'%1' could use '%2' (%3 MB)").arg(file).arg(lighter).arg(static_cast<double>(lighterBytes) / (1024.0 * 1024.0), 0, 'f', 1), false);
+			}
 		}
-		newlines.push_back(outLine);
 	}
+	emit SendMessage(QString("Measured %1 model files").arg(paths.size()), spdlog::level::level_enum::debug, QString());
+	return true;
+}
 
-	try
+void ThreeDModelFinder::EnsureModelIndex(QString const& libraryPath)
+{
+	if (!modelIndexChecked)
 	{
-		if (QFile::exists(pcbPath + "_old"))
-		{
-			QFile::remove(pcbPath + "_old");
-		}
+		IndexModels(libraryPath);
+		modelIndexChecked = true;
+	}
+}
 
-		QFile::rename(pcbPath, pcbPath + "_old");
+void ThreeDModelFinder::IndexModels(QString const& libraryPath)
+{
+	QStringList roots;
+	if (!libraryPath.isEmpty())
+	{
+		roots.append(libraryPath);
 	}
-	catch (std::exception /*ex*/)
+	QString const modelDir{ m_paths->Variable(MODEL_DIR_VAR) };
+	if (!modelDir.isEmpty() && (libraryPath.isEmpty() || !QDir::cleanPath(modelDir).startsWith(QDir::cleanPath(libraryPath) + "/")))
 	{
-		emit SendMessage(QString("Could not Create '%1_old'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
+		roots.append(modelDir);
 	}
 
-	QFile outFile(pcbPath);
-	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text))
+	//the KiCad model folder holds tens of thousands of files, it is only walked again when a folder changed
+	if (modelIndex.Current(roots))
 	{
-		emit SendMessage(QString("Could not Open '%1'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
-		return false;
-	}
-	QTextStream out(&outFile);
-	for (auto const& line : newlines) {
-		out << line << "\n";
+		return;
 	}
-	outFile.close();
 
-	return true;
+	modelIndex.Clear();
+	for (auto const& root : roots)
+	{
+		//the watched library folder answers from memory, anything else is walked once
+		if (m_liveFolderIndex && m_liveFolderIndex->Covers(root))
+		{
+			IndexLibraryFolder(root);
+		}
+		QStringList folders;
+		auto const files{ FindRecurseFiles(root, ModelIndex::NameFilters(), &folders) };
+		modelIndex.AddRoot(root, files, folders);
+		ReleaseLibraryFolder();
+	}
+	emit SendMessage(QString("Indexed %1 3D models").arg(modelIndex.size()), spdlog::level::level_enum::debug, libraryPath);
 }
 
-QString ThreeDModelFinder::getThreeDModelPath(QString const& line) const
+QString ThreeDModelFinder::RelinkModel(QString const& model, QString const& libraryPath)
 {
-	//    (model "${KICAD6_3DMODEL_DIR}/Resistor_SMD.3dshapes/R_0603_1608Metric.wrl"
-	QString prop(R"((model )");
-	int stInd = line.indexOf(prop);
-
-	if (stInd == -1)
+	EnsureModelIndex(libraryPath);
+	QString const found{ modelIndex.Find(model) };
+	if (found.isEmpty())
 	{
 		return QString();
 	}
-	int endInd = line.indexOf("(", stInd + 1);
 
-	if (endInd == -1)
+	QString const modelDir{ QDir::cleanPath(m_paths->Variable(MODEL_DIR_VAR)) };
+	if (!modelDir.isEmpty() && found.startsWith(modelDir + "/"))
 	{
-		endInd = line.length();
+		return QString("${%1}%2").arg(MODEL_DIR_VAR).arg(found.mid(modelDir.size()));
 	}
+	return ConvertToRelativePath(found, libraryPath);
+}
+
 
-	if (stInd == endInd || stInd == -1 || endInd == -1)
+bool ThreeDModelFinder::FixThreeDModels(QString const& folder)
+{
+	bool worked{ false };
+	/*
+		Three Steps of "fixing" footprints
+		1) Convert absolute paths to relative paths in Footprint Table
+		2) Find librarys in library folder and add Footprint Table
+		3) IDK
+	*/
+	if (incorrectThreeDModelFileList.empty())
 	{
-		return QString();
+		CheckPCBs();
 	}
-	int nstr = stInd + prop.size() + 1;
-	QString value = line.mid(nstr, endInd - nstr - 1);
+	//the model index is only built once a model turns out to be missing
+	modelIndexChecked = false;
 
-	value = kicad_utils::CleanQuotes(value);
-	return value;
-}
+	//if(ConvertAllPathsToRelative(folder))
+	//{
+	//    emit SendClearResults();
+	//    CheckPCBs();
+	//}
 
+	for (auto const& filePath : incorrectThreeDModelFileList)
+	{
+		if (AttemptToFixThreeDModelFile(filePath, folder))
+		{
+			worked = true;
+			emit SendMessage(QString("Fixed '%1'").arg(filePath), spdlog::level::level_enum::debug, filePath);
+		}
+	}
+	if (worked)
+	{
+		//QString localLibPath {m_projectFolder + "/fp-lib-table"};
+		emit SendClearResults();
+		CheckPCBs();
+	}
 
-QString ThreeDModelFinder::getPCBReference(QString const& line) const
-{
-	//    (fp_text reference "J30" 
-	QString prop(R"((fp_text reference)");
-	int stInd = line.indexOf(prop);
+	return worked;
+}
 
-	if (stInd == -1)
+bool ThreeDModelFinder::AttemptToFixThreeDModelFile(QString const& pcbPath, QString const& libraryPath)
+{
+	//the board is only mapped, the new one is streamed to a temp file next to it
+	QSaveFile outFile(pcbPath);
 	{
-		return QString();
+		MappedFile const inFile(pcbPath);
+		if (!inFile.isOpen())
+		{
+			emit SendMessage(QString("Could not Open '%1'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
+			return false;
+		}
+		auto const data{ inFile.data() };
+
+		std::map<QString, QString> convertList;
+		std::map<QString, QString> relinkList;	//model path -> relinked path, empty if it exists or nothing was found
+		std::vector<FilePatch> patches;
+		static MarkerScanner const markers{ "model" };
+		for (auto const offset : markers.Scan(data))
+		{
+			//    (model "${KICAD6_3DMODEL_DIR}/Resistor_SMD.3dshapes/R_0603_1608Metric.wrl"
+			SexprTokenizer tokens(data, offset);
+			tokens.Next();
+			if (!tokens.Next().isAtom("model"))
+			{
+				continue;
+			}
+			auto const path{ tokens.Next() };
+			if (!path.isValue() || path.text.empty())
+			{
+				continue;
+			}
+
+			QString const model{ path.toQString() };
+			QString newPath;
+			if (model.startsWith("${KISYS3DMOD}"))
+			{
+				newPath = QString(model).replace("${KISYS3DMOD}", QString("${%1}").arg(MODEL_DIR_VAR));
+				emit SendMessage(QString("Updating '${KISYS3DMOD}' to '${%1}'").arg(MODEL_DIR_VAR), spdlog::level::level_enum::debug, QString());
+			}
+			else if (!model.startsWith("$"))
+			{
+				if (!convertList.contains(model))
+				{
+					convertList.insert({ model, ConvertToRelativePath(model, libraryPath) });
+				}
+				newPath = convertList.at(model);
+				if (!newPath.isEmpty() && newPath != model)
+				{
+					emit SendMessage(QString("Updating '%1' to '%2'").arg(model).arg(newPath), spdlog::level::level_enum::debug, QString());
+				}
+			}
+
+			//a model that is gone is relinked to where the index finds its file now, each path is only looked at once
+			QString const current{ newPath.isEmpty() ? model : newPath };
+			if (!relinkList.contains(current))
+			{
+				relinkList.insert({ current, ModelExists(current) ? QString() : RelinkModel(model, libraryPath) });
+			}
+			if (!relinkList.at(current).isEmpty())
+			{
+				newPath = relinkList.at(current);
+				emit SendMessage(QString("Relinking '%1' to '%2'").arg(model).arg(newPath), spdlog::level::level_enum::debug, QString());
+			}
+			if (newPath.isEmpty() || newPath == model)
+			{
+				continue;
+			}
+
+			std::size_t const end{ static_cast<std::size_t>(path.text.data() - data.data()) + path.text.size() + (path.type == SexprToken::Type::String ? 1 : 0) };
+			patches.push_back({ path.offset, std::min(end, data.size()) - path.offset, SexprTokenizer::Encode(newPath) });
+		}
+
+		if (patches.empty())
+		{
+			//nothing to change, the board is left untouched
+			return false;
+		}
+
+		if (!outFile.open(QIODevice::WriteOnly) || !file_patch::Stream(outFile, data, std::move(patches)))
+		{
+			emit SendMessage(QString("Could not Write '%1'").arg(pcbPath), spdlog::level::level_enum::warn, pcbPath);
+			return false;
+		}
 	}
-	int endInd = line.indexOf("(", stInd + 1);
 
-	if (stInd == endInd || stInd == -1 || endInd == -1)
+	if (QString error; !file_patch::CommitWithBackup(outFile, pcbPath, error))
 	{
-		return QString();
+		emit SendMessage(error, spdlog::level::level_enum::warn, pcbPath);
+		return false;
 	}
-    int nstr = stInd + prop.size() + 1;
-	QString value = line.mid(nstr, endInd - nstr - 1);
-
-	value = kicad_utils::CleanQuotes(value);
-	return value;
+	return true;
 }
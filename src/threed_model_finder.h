@@ -5,10 +5,17 @@
 
 #include "spdlog/spdlog.h"
 
+#include "board_document.h"
 #include "library_base.h"
+#include "model_index.h"
 
 #include <QObject>
+#include <QDir>
 #include <QMap>
+#include <QHash>
+
+#include <memory>
+#include <vector>
 
 class ThreeDModelFinder : public LibraryBase
 {
@@ -20,6 +27,10 @@ public:
 
 	bool CheckPCBs();
 	bool FixThreeDModels(QString const& folder);
+	//heaviest models of each board by file size and entity count, with lighter files of the same name from the model index
+	bool AuditModelWeights(QString const& libraryPath);
+	//footprints that differ between the schematic sheets and each board, or are only on one side
+	bool CompareSchematics();
 
 	void LoadProject(QString const& folder) override;
 
@@ -31,15 +42,36 @@ private:
 
 	LibraryInfo DecodeLibraryInfo(QString const& path, QString const& libFolder) const override { return LibraryInfo(); }
 
-	void CheckPCB(QString const& pcbPath);
+	//boards of files read in parallel, null where a file couldn't be opened
+	std::vector<std::shared_ptr<BoardDocument const>> LoadBoards(QFileInfoList const& files) const;
+	void CheckPCB(BoardDocument const& board);
+	//the root sheet of project and every sub sheet below it, one level read in parallel at a time
+	//falls back to the top level .kicad_sch files when there is no root sheet
+	std::vector<std::shared_ptr<SchematicDocument const>> LoadSheets(QDir const& directory, QString const& project) const;
+
+	//model path made absolute, ${VAR}s expanded and relative paths taken from the project folder
+	QString ResolveModel(QString const& model) const;
+	//resolved path and the .wrl/.wrz/.step/.stp files KiCad falls back to
+	static QStringList ModelCandidates(QString const& resolved);
+	//stats every unique candidate of boards once, on a thread pool
+	void StatModels(std::vector<std::shared_ptr<BoardDocument const>> const& boards);
+	bool ModelExists(QString const& model) const;
+	//the file KiCad loads for model, the path itself or the first alternate that exists
+	QString ExistingModel(QString const& model) const;
+
+	//indexes the models below libraryPath and the KiCad 3D model folder, kept while none of their folders change
+	void IndexModels(QString const& libraryPath);
+	//IndexModels once per Fix/Audit run, only called when a model has to be looked up
+	void EnsureModelIndex(QString const& libraryPath);
+	//table path of the indexed model that model most likely moved to, empty if there is none
+	QString RelinkModel(QString const& model, QString const& libraryPath);
 
 	bool AttemptToFixThreeDModelFile(QString const& pcbPath, QString const& libraryPath);
 
-	QString getThreeDModelPath(QString const& line) const;
-
-	QString getPCBReference(QString const& line) const;
-
 	QStringList incorrectThreeDModelFileList;
+	QHash<QString, bool> modelFiles;	//candidate path -> exists, for the current CheckPCBs run
+	ModelIndex modelIndex;
+	bool modelIndexChecked{ false };	//modelIndex was validated in this run
 };
 
 #endif